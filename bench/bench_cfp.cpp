@@ -0,0 +1,844 @@
+/*
+ * bench/bench_cfp.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cfp/cfp.h>
+#include "charclass.h"
+#include "prescan.h"
+#include "parserstate.h"
+
+/// Approximate number of characters to process per measurement.
+#define CHARS_PER_RUN 4000000
+
+/// Number of formulas of each corpus of benchCorpora() and benchStages().
+#define CORPUS_SIZE 2000
+
+/// Number of calls of the global operator new, by any thread.
+static std::atomic<size_t> allocationCount(0);
+
+/// Not inlined either, GCC would pair its malloc() with the builtin
+/// operator delete.
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void * 
+operator new(std::size_t size)
+{
+	allocationCount++;
+	void * p = std::malloc(size ? size : 1);
+	if (!p) {
+#ifdef CFP_NO_EXCEPTIONS
+		std::abort();
+#else
+		throw std::bad_alloc();
+#endif
+	}
+	return p;
+}
+
+/// Not inlined, GCC would warn about free() after a builtin operator new.
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void 
+operator delete(void * p) throw()
+{
+	std::free(p);
+}
+
+/// A single result of a benchmark.
+struct Measurement
+{
+	std::string section; //!< Benchmark function, e.g. "lexer".
+	std::string name;    //!< Case within the section.
+	std::string metric;  //!< Unit of the value, e.g. "ns/char".
+	double      value;   //!< The measured value.
+};
+
+/// All results, written at the end if JSON output is requested.
+static std::vector<Measurement> measurements;
+
+/// True, if the results are written as JSON instead of tables.
+static bool jsonOutput = false;
+
+/// Records a result for the JSON output.
+static void 
+record(const std::string& section, const std::string& name, 
+       const std::string& metric, double value)
+{
+	Measurement m = { section, name, metric, value };
+	measurements.push_back(m);
+}
+
+/// Returns the stream for the tables, which are discarded if JSON 
+/// output is requested.
+static std::ostream& 
+text(void)
+{
+	static std::ostringstream discard;
+	if (!jsonOutput) return std::cout;
+	discard.str("");
+	return discard;
+}
+
+/// Returns \e str as JSON string literal.
+static std::string 
+jsonString(const std::string& str)
+{
+	std::string out("\"");
+	for(size_t i=0; i < str.length(); i++) {
+		if (str[i] == '"' || str[i] == '\\') out += '\\';
+		out += str[i];
+	}
+	return out + "\"";
+}
+
+/// Writes all recorded results as JSON array of objects.
+static void 
+writeJson(std::ostream& o)
+{
+	o << "{\n  \"benchmark\": \"bench_cfp\",\n  \"results\": [";
+	for(size_t i=0; i < measurements.size(); i++)
+	{
+		const Measurement& m = measurements[i];
+		o << (i ? "," : "") << "\n    { \"section\": " << jsonString(m.section)
+		  << ", \"name\": " << jsonString(m.name)
+		  << ", \"metric\": " << jsonString(m.metric)
+		  << ", \"value\": " << std::setprecision(6) << m.value << " }";
+	}
+	o << "\n  ]\n}" << std::endl;
+}
+
+/// Returns the decimal representation of \e n.
+static std::string 
+decimal(size_t n)
+{
+	std::ostringstream ss;
+	ss << n;
+	return ss.str();
+}
+
+/// Returns the CPU time in seconds since \e start.
+static double 
+secondsSince(std::clock_t start)
+{
+	return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+/// Builds a formula with \e depth nested groups: (H(H(H...)2)2)2
+static std::string 
+nestedFormula(size_t depth)
+{
+	std::string str;
+	for(size_t i=0; i < depth; i++) str.append("(H");
+	for(size_t i=0; i < depth; i++) str.append(")2");
+	return str;
+}
+
+/// Processes deeply nested formulas of growing depth.
+/// The time per character has to stay constant if the effort
+/// for building the element tree is linear in the formula length.
+static void 
+benchNesting(void)
+{
+	text() << "nesting: depth, chars, runs, ns/char" << std::endl;
+	for(size_t depth = 64; depth <= 16384; depth *= 4)
+	{
+		cfp::Parser p;
+		p.setMaxNestingLevel(depth+1);
+		std::string str = nestedFormula(depth);
+		size_t runs = CHARS_PER_RUN / str.length() + 1;
+		std::clock_t start = std::clock();
+		for(size_t i=0; i < runs; i++) {
+			p.processView(str.c_str(), str.length());
+		}
+		double t = secondsSince(start) * 1e9 / (double(runs) * str.length());
+		text() << std::setw(10) << depth 
+		       << std::setw(10) << str.length()
+		       << std::setw(10) << runs
+		       << std::setw(10) << std::setprecision(3) << t
+		       << std::endl;
+		record("nesting", "depth " + decimal(depth), "ns/char", t);
+	}
+}
+
+/// Builds a formula of at least \e len characters by repeating \e unit.
+static std::string 
+repeatedFormula(const std::string& unit, size_t len)
+{
+	std::string str;
+	while (str.length() < len) str.append(unit);
+	return str;
+}
+
+/// Processes long formulas of different character mixes.
+/// Mostly measures the per character cost of the lexer.
+static void 
+benchLexer(void)
+{
+	const char * units[] = {
+		"C6H5CH2CH2NH2",           // organic, short symbols, integers
+		"Abcdefgh Ijklmnop ",      // long symbols, spaces
+		"H2,5 O1.25 N0.5 ",        // decimal coefficients
+		"13C2 H(2)3 [15N]4.5 ",    // isotopes
+		NULL
+	};
+	text() << "lexer: formula, chars, runs, ns/char" << std::endl;
+	for(size_t u=0; units[u]; u++)
+	{
+		cfp::Parser p;
+		std::string str = repeatedFormula(units[u], 4096);
+		size_t runs = CHARS_PER_RUN / str.length() + 1;
+		std::clock_t start = std::clock();
+		for(size_t i=0; i < runs; i++) {
+			p.processView(str.c_str(), str.length());
+		}
+		double t = secondsSince(start) * 1e9 / (double(runs) * str.length());
+		text() << std::setw(24) << units[u]
+		       << std::setw(8) << str.length()
+		       << std::setw(8) << runs
+		       << std::setw(10) << std::setprecision(3) << t
+		       << std::endl;
+		record("lexer", units[u], "ns/char", t);
+	}
+}
+
+/// Returns the CPU time per character of processing \e str \e runs 
+/// times by \e p.
+static double 
+processTime(cfp::Parser& p, const std::string& str, size_t runs)
+{
+	std::clock_t start = std::clock();
+	for(size_t i=0; i < runs; i++) {
+		p.processView(str.c_str(), str.length());
+	}
+	return secondsSince(start) * 1e9 / (double(runs) * str.length());
+}
+
+/// Compares building the element tree and flattening it to the
+/// empirical-only mode which accumulates the result in a single pass.
+static void 
+benchEmpiricalOnly(void)
+{
+	const char * names[] = {
+		"C6H5CH2CH2NH2",           // organic, no groups
+		"Ca(OH)2 [Fe(CN)6]4 ",     // groups
+		"13C2 H(2)3 [15N]4.5 ",    // isotopes
+		"(H(H(H...)2)2)2",         // deeply nested
+		NULL
+	};
+	std::string formulas[] = {
+		repeatedFormula(names[0], 64),
+		repeatedFormula(names[1], 64),
+		repeatedFormula(names[2], 64),
+		nestedFormula(1024)
+	};
+	text() << "empirical: formula, chars, tree ns/char, "
+	       << "empirical-only ns/char, speedup" << std::endl;
+	for(size_t u=0; names[u]; u++)
+	{
+		const std::string& str = formulas[u];
+		size_t runs = CHARS_PER_RUN / str.length() + 1;
+		cfp::Parser tree, flat;
+		tree.setMaxNestingLevel(str.length());
+		flat.setMaxNestingLevel(str.length());
+		flat.setEmpiricalOnly(true);
+		double tTree = processTime(tree, str, runs);
+		double tFlat = processTime(flat, str, runs);
+		text() << std::setw(24) << names[u]
+		       << std::setw(8) << str.length()
+		       << std::setw(10) << std::setprecision(3) << tTree
+		       << std::setw(10) << std::setprecision(3) << tFlat
+		       << std::setw(10) << std::setprecision(3) << (tTree / tFlat)
+		       << std::endl;
+		record("empirical", std::string(names[u]) + " tree", "ns/char", tTree);
+		record("empirical", std::string(names[u]) + " empirical-only", 
+		       "ns/char", tFlat);
+	}
+}
+
+/// Compares processing long formulas in empirical-only mode to checking
+/// their syntax only.
+static void 
+benchValidate(void)
+{
+	const char * names[] = {
+		"C6H5CH2CH2NH2",           // organic, no groups
+		"Ca(OH)2 [Fe(CN)6]4 ",     // groups
+		"(H(H(H...)2)2)2",         // deeply nested
+		NULL
+	};
+	std::string formulas[] = {
+		repeatedFormula(names[0], 1 << 16),
+		repeatedFormula(names[1], 1 << 16),
+		nestedFormula(1024)
+	};
+	text() << "validate: formula, chars, process ns/char, "
+	       << "validate ns/char, validate MB/s" << std::endl;
+	for(size_t u=0; names[u]; u++)
+	{
+		const std::string& str = formulas[u];
+		size_t runs = CHARS_PER_RUN / str.length() + 1;
+		cfp::Parser p;
+		p.setMaxNestingLevel(str.length());
+		p.setEmpiricalOnly(true);
+		double tProcess = processTime(p, str, runs);
+		std::clock_t start = std::clock();
+		size_t valid = 0;
+		for(size_t i=0; i < runs; i++) {
+			valid += p.validate(str.c_str(), str.length()).ok();
+		}
+		double tValidate = secondsSince(start) * 1e9 / (double(runs) * str.length());
+		text() << std::setw(24) << names[u]
+		       << std::setw(8) << str.length()
+		       << std::setw(10) << std::setprecision(3) << tProcess
+		       << std::setw(10) << std::setprecision(3) << tValidate
+		       << std::setw(10) << std::setprecision(4) << (1e3 / tValidate)
+		       << std::endl;
+		if (valid != runs) text() << "unexpected" << std::endl;
+		record("validate", std::string(names[u]) + " process", "ns/char", 
+		       tProcess);
+		record("validate", std::string(names[u]) + " validate", "ns/char", 
+		       tValidate);
+	}
+}
+
+/// Compares processing many short formulas one by one to parsing them
+/// as batch into a columnar result.
+static void 
+benchBatch(void)
+{
+	const char * units[] = {
+		"C6H5CH2CH2NH2", "Ca(OH)2", "[Fe(CN)6]4", "H2O", "13C2H6", 
+		"NaCl", "H2SO4", "C8H10N4O2", "(CH3)3COH", "Mg(OH)2.5"
+	};
+	const size_t count = 100000;
+	std::vector<cfp::FormulaView> formulas(count);
+	size_t chars = 0;
+	for(size_t i=0; i < count; i++) {
+		formulas[i].str = units[i % 10];
+		formulas[i].len = std::strlen(units[i % 10]);
+		chars += formulas[i].len;
+	}
+	size_t runs = CHARS_PER_RUN / chars + 1;
+
+	cfp::Parser p;
+	std::clock_t start = std::clock();
+	for(size_t r=0; r < runs; r++) {
+		for(size_t i=0; i < count; i++) {
+			p.processView(formulas[i].str, formulas[i].len);
+		}
+	}
+	double tSingle = secondsSince(start);
+
+	cfp::BatchResult result;
+	start = std::clock();
+	for(size_t r=0; r < runs; r++) {
+		p.parseBatch(&formulas[0], count, result);
+	}
+	double tBatch = secondsSince(start);
+
+	// CPU time adds up over all threads, measure the elapsed time
+	std::chrono::steady_clock::time_point wallStart = 
+		std::chrono::steady_clock::now();
+	for(size_t r=0; r < runs; r++) {
+		p.parseBatchParallel(&formulas[0], count, result);
+	}
+	double tParallel = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - wallStart).count();
+
+	// repetitive input, the results are looked up after the first run
+	cfp::FormulaCache cache;
+	p.setCache(&cache);
+	start = std::clock();
+	for(size_t r=0; r < runs; r++) {
+		p.parseBatch(&formulas[0], count, result);
+	}
+	double tCached = secondsSince(start);
+	p.setCache(NULL);
+
+	double n = double(runs) * count;
+	text() << "batch: method, ns/formula" << std::endl;
+	text() << std::setw(10) << "single" << std::setw(10) 
+	       << std::setprecision(3) << (tSingle * 1e9 / n) << std::endl;
+	text() << std::setw(10) << "batch" << std::setw(10) 
+	       << std::setprecision(3) << (tBatch * 1e9 / n) << std::endl;
+	text() << std::setw(10) << "cached" << std::setw(10) 
+	       << std::setprecision(3) << (tCached * 1e9 / n) << std::endl;
+	text() << std::setw(10) << "parallel" << std::setw(10) 
+	       << std::setprecision(3) << (tParallel * 1e9 / n) 
+	       << "  (" << std::thread::hardware_concurrency() << " threads)"
+	       << std::endl;
+	record("batch", "single", "ns/formula", tSingle * 1e9 / n);
+	record("batch", "batch", "ns/formula", tBatch * 1e9 / n);
+	record("batch", "cached", "ns/formula", tCached * 1e9 / n);
+	record("batch", "parallel", "ns/formula", tParallel * 1e9 / n);
+}
+
+/// Formulas of a common shape, see makeCorpora().
+struct Corpus
+{
+	const char *             name;     //!< Shape of the formulas.
+	std::vector<std::string> formulas; //!< The formulas.
+	std::vector<cfp::FormulaView> views; //!< Views of formulas.
+	size_t                   chars;    //!< Total number of characters.
+};
+
+/// Picks one of \e n items, deterministic for all platforms.
+static size_t 
+pick(std::mt19937& rng, size_t n)
+{
+	return size_t(rng() % n);
+}
+
+/// Returns a random natural number as string, "" for 1 in some cases.
+static std::string 
+count(std::mt19937& rng, size_t max)
+{
+	size_t n = 1 + pick(rng, max);
+	return n == 1 ? std::string() : decimal(n);
+}
+
+/// Builds a group nested \e depth levels deep, each level consisting of
+/// an element and the next level.
+static std::string 
+nestedGroup(std::mt19937& rng, size_t depth)
+{
+	const char * symbols[] = { "C", "H", "N", "O", "Fe", "Cu", "S", "P" };
+	std::string str = std::string(symbols[pick(rng, 8)]) + count(rng, 4);
+	if (depth > 0) {
+		const char * brackets[] = { "()", "[]", "{}" };
+		const char * b = brackets[pick(rng, 3)];
+		str += b[0] + nestedGroup(rng, depth-1) + b[1] + count(rng, 6);
+	}
+	return str;
+}
+
+/// Inserts a single error into a valid formula.
+static std::string 
+malformed(std::mt19937& rng, std::string str)
+{
+	const size_t pos = pick(rng, str.length());
+	switch (pick(rng, 6))
+	{
+		case 0: str[pos] = '$'; break;                  // invalid character
+		case 1: str.insert(pos, ")"); break;            // lone bracket
+		case 2: str.insert(pos, "("); break;            // missing bracket
+		case 3: str.insert(0, "x"); break;              // lower case start
+		case 4: str.insert(0, "2.5"); break;            // leading coefficient
+		default: str.insert(pos, ".."); break;          // decimal separators
+	}
+	return str;
+}
+
+/// Builds the corpora used by benchCorpora() and benchStages(). The 
+/// formulas are generated with a fixed seed, so each run and each 
+/// version of the library measures the same input.
+static std::vector<Corpus> 
+makeCorpora(void)
+{
+	const char * inorganic[] = {
+		"NaCl", "H2O", "H2SO4", "Fe2O3", "CaCO3", "KMnO4", "Al2(SO4)3",
+		"Mg(OH)2", "NH4NO3", "CuSO4", "Na2B4O7", "K4[Fe(CN)6]", "SiO2",
+		"Ca3(PO4)2", "HCl", "NaHCO3"
+	};
+	const char * organicUnits[] = {
+		"CH2", "CH3", "C6H4", "OH", "NH2", "COOH", "C(O)", "CH(CH3)", 
+		"C2H5", "OCH3", "C6H5", "N(CH3)2"
+	};
+	const char * coefUnits[] = {
+		"Mg(OH)2.5", "H2,5O1.25", "(CH3)3.75", "Na0.5Cl0.5", "[Fe(CN)6]0.25",
+		"(SiO2)1,5", "Ca0.33"
+	};
+	std::mt19937 rng(2009);
+	std::vector<Corpus> corpora(5);
+	corpora[0].name = "short inorganic";
+	corpora[1].name = "long organic";
+	corpora[2].name = "deeply nested";
+	corpora[3].name = "coefficient heavy";
+	corpora[4].name = "malformed";
+	for(size_t i=0; i < CORPUS_SIZE; i++)
+	{
+		corpora[0].formulas.push_back(inorganic[pick(rng, 16)]);
+
+		std::string organic;
+		for(size_t n = 10 + pick(rng, 30); n > 0; n--) {
+			organic += organicUnits[pick(rng, 12)];
+		}
+		corpora[1].formulas.push_back(organic);
+
+		corpora[2].formulas.push_back(nestedGroup(rng, 10 + pick(rng, 18)));
+
+		std::string coef;
+		for(size_t n = 2 + pick(rng, 6); n > 0; n--) {
+			coef += coefUnits[pick(rng, 7)];
+		}
+		corpora[3].formulas.push_back(coef);
+
+		corpora[4].formulas.push_back(malformed(rng, 
+			corpora[pick(rng, 4)].formulas.back()));
+	}
+	for(size_t c=0; c < corpora.size(); c++)
+	{
+		Corpus& corpus = corpora[c];
+		corpus.chars = 0;
+		for(size_t i=0; i < corpus.formulas.size(); i++) {
+			cfp::FormulaView v = { corpus.formulas[i].data(), 
+			                       corpus.formulas[i].length() };
+			corpus.views.push_back(v);
+			corpus.chars += v.len;
+		}
+	}
+	return corpora;
+}
+
+/// Returns the number of passes over \e corpus for a measurement.
+static size_t 
+corpusRuns(const Corpus& corpus)
+{
+	return CHARS_PER_RUN / corpus.chars + 1;
+}
+
+/// Measures the stages of parsing separately for each corpus:
+/// the structural index, the lexer and grammar alone ( validate ), 
+/// building the element tree, flattening it and writing the result 
+/// as string and markup. The time per formula is reported.
+static void 
+benchStages(const std::vector<Corpus>& corpora)
+{
+	text() << "stages: corpus, ns/formula of index, lex, tree, flatten, "
+	       << "toString, toMarkup" << std::endl;
+	for(size_t c=0; c < corpora.size(); c++)
+	{
+		const Corpus& corpus = corpora[c];
+		const size_t n = corpus.views.size();
+		const size_t runs = corpusRuns(corpus);
+		const double formulas = double(runs) * n;
+		double t[6] = { 0 };
+
+		cfp::StructuralIndex idx;
+		std::clock_t start = std::clock();
+		for(size_t r=0; r < runs; r++) {
+			for(size_t i=0; i < n; i++) {
+				idx.build(corpus.views[i].str, corpus.views[i].len);
+			}
+		}
+		t[0] = secondsSince(start);
+
+		cfp::ParserState lexer;
+		size_t valid = 0;
+		start = std::clock();
+		for(size_t r=0; r < runs; r++) {
+			for(size_t i=0; i < n; i++) {
+				valid += lexer.validate(corpus.views[i].str, 
+				                        corpus.views[i].len).ok();
+			}
+		}
+		t[1] = secondsSince(start);
+
+		// one state for each formula keeps its tree for the later stages
+		std::vector<cfp::ParserState> states(n);
+		start = std::clock();
+		for(size_t r=0; r < runs; r++) {
+			for(size_t i=0; i < n; i++) {
+				states[i].resetView(corpus.views[i].str, corpus.views[i].len);
+				states[i].parse();
+			}
+		}
+		t[2] = secondsSince(start);
+
+		// the following stages need a result
+		std::vector<size_t> ok;
+		for(size_t i=0; i < n; i++) {
+			if (lexer.validate(corpus.views[i].str, corpus.views[i].len).ok()) {
+				ok.push_back(i);
+			}
+		}
+		if (!ok.empty()) 
+		{
+			const size_t okRuns = CHARS_PER_RUN / (corpus.chars * ok.size() / n + 1) + 1;
+			start = std::clock();
+			for(size_t r=0; r < okRuns; r++) {
+				for(size_t k=0; k < ok.size(); k++) {
+					states[ok[k]].rootGroup().flatten(cfp::ORDER_LEXICAL);
+				}
+			}
+			t[3] = secondsSince(start);
+
+			size_t chars = 0;
+			std::ostringstream ss;
+			start = std::clock();
+			for(size_t r=0; r < okRuns; r++) {
+				for(size_t k=0; k < ok.size(); k++) {
+					ss.str("");
+					ss << states[ok[k]].rootGroup().flatList();
+					chars += ss.str().length();
+				}
+			}
+			t[4] = secondsSince(start);
+
+			start = std::clock();
+			for(size_t r=0; r < okRuns; r++) {
+				for(size_t k=0; k < ok.size(); k++) {
+					chars += cfp::toMarkup(
+						states[ok[k]].rootGroup().flatList()).length();
+				}
+			}
+			t[5] = secondsSince(start);
+			for(size_t s=3; s < 6; s++) t[s] *= formulas / (double(okRuns) * ok.size());
+			if (chars == 0) text() << "unexpected" << std::endl;
+		}
+
+		const char * stages[] = { 
+			"index", "lex", "tree", "flatten", "toString", "toMarkup" 
+		};
+		text() << std::setw(20) << corpus.name;
+		for(size_t s=0; s < 6; s++) 
+		{
+			if (s >= 3 && ok.empty()) {
+				text() << std::setw(10) << "-";
+				continue;
+			}
+			text() << std::setw(10) << std::setprecision(3) 
+			       << (t[s] * 1e9 / formulas);
+			record("stages", std::string(corpus.name) + " " + stages[s], 
+			       "ns/formula", t[s] * 1e9 / formulas);
+		}
+		text() << std::endl;
+	}
+}
+
+/// Measures the end-to-end parsing of each corpus by the public API:
+/// the element tree ( process ), empirical-only mode, parseBatch and 
+/// validate. Reports the time and the heap allocations per formula of 
+/// a Parser which parsed the corpus once already.
+static void 
+benchCorpora(const std::vector<Corpus>& corpora)
+{
+	const char * methods[] = { "tree", "empirical-only", "batch", "validate" };
+	text() << "corpora: corpus, method, chars/formula, ns/formula, MB/s, "
+	       << "allocs/formula" << std::endl;
+	for(size_t c=0; c < corpora.size(); c++)
+	{
+		const Corpus& corpus = corpora[c];
+		const size_t n = corpus.views.size();
+		const size_t runs = corpusRuns(corpus);
+		for(size_t m=0; m < 4; m++)
+		{
+			cfp::Parser p;
+			p.setEmpiricalOnly(m > 0);
+			cfp::BatchResult result;
+			size_t allocations = 0;
+			std::clock_t start = 0;
+			// the first pass warms up, the second counts allocations
+			for(size_t r=0; r < runs+2; r++) 
+			{
+				if (r == 1) allocations = allocationCount;
+				if (r == 2) {
+					allocations = allocationCount - allocations;
+					start = std::clock();
+				}
+				if (m == 2) {
+					p.parseBatch(&corpus.views[0], n, result);
+					continue;
+				}
+				for(size_t i=0; i < n; i++) {
+					const cfp::FormulaView& v = corpus.views[i];
+					if (m == 3) p.validate(v.str, v.len);
+					else        p.tryProcessView(v.str, v.len);
+				}
+			}
+			double t = secondsSince(start);
+			double perFormula = t * 1e9 / (double(runs) * n);
+			double mbs = double(runs) * corpus.chars / t / 1e6;
+			double allocs = double(allocations) / n;
+			text() << std::setw(20) << corpus.name 
+			       << std::setw(16) << methods[m]
+			       << std::setw(8) << (corpus.chars / n)
+			       << std::setw(10) << std::setprecision(3) << perFormula
+			       << std::setw(10) << std::setprecision(4) << mbs
+			       << std::setw(10) << std::setprecision(3) << allocs
+			       << std::endl;
+			std::string name = std::string(corpus.name) + " " + methods[m];
+			record("corpora", name, "ns/formula", perFormula);
+			record("corpora", name, "MB/s", mbs);
+			record("corpora", name, "allocs/formula", allocs);
+		}
+	}
+}
+
+/// Character classification by conditional tests as done by the
+/// parser up to libcfp 0.2, for reference.
+static int 
+charClassChain(char c)
+{
+	if (( 48 <= c) && (c <= 57 )) return cfp::CHAR_NUM;
+	if (( 44 == c) || (c == 46 )) return cfp::CHAR_DECIM;
+	if (( 65 <= c) && (c <= 90 )) return cfp::CHAR_ALPHA_U;
+	if (( 97 <= c) && (c <= 122)) return cfp::CHAR_ALPHA_L;
+	if (( 40 == c) || ( 91 == c) || (123 == c)) return cfp::CHAR_BRACKET_O;
+	if ((c == 41 ) || (c == 93 ) || (c == 125)) return cfp::CHAR_BRACKET_C;
+	if ( 32 == c) return cfp::CHAR_SPACE;
+	return cfp::CHAR_INVALID;
+}
+
+/// Classifies the characters of a mixed formula by conditional tests
+/// and by the lookup table ( cfp::charClass() ) of the parser.
+static void 
+benchCharClass(void)
+{
+	std::string str = repeatedFormula(
+		"C6H5CH2CH2NH2 H2,5O1.25 13C2 H(2)3 [15N]4.5 (Abc)2", 1 << 16);
+	size_t runs = CHARS_PER_RUN * 8 / str.length() + 1;
+	size_t hist[cfp::CHAR_CLASS_COUNT] = { 0 };
+
+	std::clock_t start = std::clock();
+	for(size_t i=0; i < runs; i++) {
+		for(size_t k=0; k < str.length(); k++) {
+			hist[charClassChain(str[k])]++;
+		}
+	}
+	double tChain = secondsSince(start);
+
+	start = std::clock();
+	for(size_t i=0; i < runs; i++) {
+		for(size_t k=0; k < str.length(); k++) {
+			hist[cfp::charClass(str[k])]++;
+		}
+	}
+	double tTable = secondsSince(start);
+
+	double chars = double(runs) * str.length();
+	text() << "charclass: method, ns/char" << std::endl;
+	text() << std::setw(10) << "chain" << std::setw(10) 
+	       << std::setprecision(3) << (tChain * 1e9 / chars) << std::endl;
+	text() << std::setw(10) << "table" << std::setw(10) 
+	       << std::setprecision(3) << (tTable * 1e9 / chars) << std::endl;
+	// keeps the results in use
+	if (hist[cfp::CHAR_INVALID] != 0) text() << "unexpected" << std::endl;
+	record("charclass", "chain", "ns/char", tChain * 1e9 / chars);
+	record("charclass", "table", "ns/char", tTable * 1e9 / chars);
+}
+
+/// Tests if two indexes contain the same classification.
+static bool 
+sameIndex(const cfp::StructuralIndex& a, const cfp::StructuralIndex& b)
+{
+	if (a.length() != b.length() || a.blocks() != b.blocks()) return false;
+	for(size_t i=0; i < a.blocks(); i++) {
+		for(size_t c=0; c < cfp::CHAR_CLASS_COUNT; c++) {
+			if (a.block(i).cls[c] != b.block(i).cls[c]) return false;
+		}
+	}
+	return true;
+}
+
+/// Builds the structural index of a large formula buffer by each 
+/// implementation supported and reports the throughput.
+/// The results of all implementations are compared to the scalar one.
+static void 
+benchPrescan(void)
+{
+	const char * names[] = { "auto", "scalar", "sse2", "avx2" };
+	// all character values, mostly valid ones
+	std::string str = repeatedFormula(
+		"C6H5CH2CH2NH2 H2,5O1.25 13C2 H(2)3 [15N]4.5 (Abc)2", 1 << 20);
+	for(size_t i=0; i < 256; i++) str[i*4099] = char(i);
+	size_t runs = CHARS_PER_RUN * 64 / str.length() + 1;
+
+	cfp::StructuralIndex ref;
+	ref.build(str.data(), str.length(), cfp::StructuralIndex::IMPL_SCALAR);
+	text() << "prescan: impl, MB/s, matches scalar" << std::endl;
+	for(int impl = cfp::StructuralIndex::IMPL_SCALAR; 
+	    impl <= cfp::StructuralIndex::IMPL_AVX2; impl++)
+	{
+		cfp::StructuralIndex::Impl im = cfp::StructuralIndex::Impl(impl);
+		if (!cfp::StructuralIndex::supported(im)) continue;
+		cfp::StructuralIndex idx;
+		std::clock_t start = std::clock();
+		for(size_t i=0; i < runs; i++) {
+			idx.build(str.data(), str.length(), im);
+		}
+		double t = double(runs) * str.length() / secondsSince(start) / 1e6;
+		text() << std::setw(10) << names[impl]
+		       << std::setw(10) << std::setprecision(4) << t
+		       << std::setw(6) << (sameIndex(idx, ref) ? "yes" : "NO")
+		       << std::endl;
+		record("prescan", names[impl], "MB/s", t);
+	}
+}
+
+/// Tells if section \e name was requested on the command line. All are 
+/// run if none is named.
+static bool 
+selected(const std::vector<std::string>& sections, const char * name)
+{
+	if (sections.empty()) return true;
+	for(size_t i=0; i < sections.size(); i++) {
+		if (sections[i] == name) return true;
+	}
+	return false;
+}
+
+/// Usage: bench_cfp [--json] [section ...]
+/// Sections: nesting lexer empirical validate batch charclass prescan 
+/// stages corpora. With --json, the results are written as JSON to 
+/// stdout instead of tables, for comparing library versions.
+int main (int argc, char * argv[])
+{
+	std::vector<std::string> sections;
+	for(int i=1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--json") == 0) jsonOutput = true;
+		else sections.push_back(argv[i]);
+	}
+	if (selected(sections, "nesting"))   benchNesting();
+	if (selected(sections, "lexer"))     benchLexer();
+	if (selected(sections, "empirical")) benchEmpiricalOnly();
+	if (selected(sections, "validate"))  benchValidate();
+	if (selected(sections, "batch"))     benchBatch();
+	if (selected(sections, "charclass")) benchCharClass();
+	if (selected(sections, "prescan"))   benchPrescan();
+	if (selected(sections, "stages") || selected(sections, "corpora")) 
+	{
+		const std::vector<Corpus> corpora = makeCorpora();
+		if (selected(sections, "stages"))  benchStages(corpora);
+		if (selected(sections, "corpora")) benchCorpora(corpora);
+	}
+	if (jsonOutput) writeJson(std::cout);
+	return 0;
+}
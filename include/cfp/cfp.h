@@ -28,8 +28,16 @@
 #define CHEM_FORMULA_PARSER_H
 
 #include <list>
+#include <vector>
+#include <stdint.h>
 #include <cfp/error.h>
 
+/// Defined, if the compiler supports rvalue references (C++11). 
+/// Enables the move constructors and move assignment operators.
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+	#define CFP_HAS_MOVE
+#endif
+
 /**
  * Contains all functions and utilities which are provided by this library for
  * parsing of chemical formulas in ASCII notation.
@@ -212,6 +220,7 @@ namespace cfp
 
 	struct ChemicalElementData; //!< Implementation data structure.
 	struct CompoundElementData; //!< Implementation data structure.
+	class  CompactElement;      //!< Compact value representation.
 
 	/**
 	 * A concrete chemical element descriptor implementation.
@@ -231,6 +240,26 @@ namespace cfp
 		
 		/// Uses generic implementation from base class.
 		using ChemicalElementInterface::operator=;
+
+		/// Copies element data into the storage of this element.
+		/// \param[in] e The element to copy data from.
+		/// \returns A reference to \e this element.
+		ChemicalElement& 
+		operator=(const ChemicalElement& e);
+
+#ifdef CFP_HAS_MOVE
+		/// Move constructor. Takes over the data of \e eb without 
+		/// copying, \e eb may only be assigned to or destroyed afterwards.
+		ChemicalElement(ChemicalElement&& eb) noexcept;
+
+		/// Move assignment. Exchanges the data with \e e.
+		ChemicalElement& 
+		operator=(ChemicalElement&& e) noexcept;
+#endif
+
+		/// Exchanges the data of two elements in constant time.
+		void 
+		swap(ChemicalElement& e) throw();
 	private:
 		/// Specific implementation of ChemicalElementInterface::doSymbol.
 		virtual std::string 
@@ -265,12 +294,36 @@ namespace cfp
 		explicit 
 		CompoundElement(const CompoundElementInterface& e);
 
+		/// Creates an element with the data of a CompactElement.
+		explicit 
+		CompoundElement(const CompactElement& e);
+
 		virtual 
 		~CompoundElement(); //!< Destructor.
 
 		/// Uses generic implementation from base class.
 		using CompoundElementInterface::operator=;
 
+		/// Copies element data into the storage of this element.
+		/// \param[in] e The element to copy data from.
+		/// \returns A reference to \e this element.
+		CompoundElement& 
+		operator=(const CompoundElement& e);
+
+#ifdef CFP_HAS_MOVE
+		/// Move constructor. Takes over the data of \e e without 
+		/// copying, \e e may only be assigned to or destroyed afterwards.
+		CompoundElement(CompoundElement&& e) noexcept;
+
+		/// Move assignment. Exchanges the data with \e e.
+		CompoundElement& 
+		operator=(CompoundElement&& e) noexcept;
+#endif
+
+		/// Exchanges the data of two elements in constant time.
+		void 
+		swap(CompoundElement& e) throw();
+
 	private:
 		/// Specific implementation of ChemicalElementInterface::doSymbol.
 		virtual std::string 
@@ -303,6 +356,395 @@ namespace cfp
 	/// \sa std::operator<<(std::ostream&, const cfp::Compound&)
 	typedef std::list<CompoundElement> Compound;
 
+	/// Order of the elements in the result of parsing a formula.
+	/// \sa Parser::setElementOrder
+	typedef enum {
+		ORDER_LEXICAL,   //!< By symbol, isotopes by nucleon number.
+		ORDER_HILL,      //!< Carbon, hydrogen, then lexical, if carbon is
+		                 //!< present. Lexical otherwise.
+		ORDER_APPEARANCE //!< In the order of first appearance.
+	} ElementOrder;
+
+	/// Identifier of an element symbol.
+	/// Each symbol is mapped to a unique id for the lifetime of the 
+	/// process, equal symbols have equal ids. The empty symbol has id 0,
+	/// the symbols of the periodic table have their atomic number as id.
+	/// Other symbols get ids above 118 in the order of their first use.
+	/// \sa symbolId, symbolString
+	typedef unsigned int SymbolId;
+
+	/// Returns the id of a symbol. Unknown symbols are registered.
+	/// May be called by several threads at the same time. Symbols of the
+	/// periodic table and the first 4096 other symbols are looked up 
+	/// without locking, registering takes a lock. Registered symbols are
+	/// kept for the lifetime of the process, so each distinct symbol of
+	/// untrusted input takes memory unless Parser::setStrictSymbols is
+	/// enabled.
+	/// \param[in] symbol The symbol to look up.
+	/// \returns Its id.
+	SymbolId symbolId(const std::string& symbol);
+
+	/// Returns the id of a symbol. Unknown symbols are registered.
+	/// \param[in] symbol The characters of the symbol.
+	/// \param[in] len    Number of characters in \e symbol.
+	/// \returns Its id.
+	SymbolId symbolId(const char * symbol, size_t len);
+
+	/// Returns the symbol of an id.
+	/// \param[in] id A symbol id as returned by symbolId().
+	/// \returns The symbol or the empty symbol for unknown ids.
+	const std::string& symbolString(SymbolId id);
+
+	/**
+	 * Compact value representation of an element within a compound.
+	 * It holds the same data as a CompoundElement: a symbol (by its id,
+	 * see symbolId() ), a nucleon number and a coefficient.
+	 * In contrast to CompoundElement it has no virtual functions and
+	 * no data on the heap. It is trivially copyable and takes 16 bytes, 
+	 * which is suitable for contiguous containers of many elements.
+	 * \see CompoundElementInterface
+	 */
+	class CompactElement
+	{
+	public:
+		/// Creates an element with the empty symbol, the natural 
+		/// nucleon number and a coefficient of 1.0.
+		CompactElement();
+
+		/// Creates an element from its data.
+		/// \param[in] symbol      Id of its symbol.
+		/// \param[in] nucleons    Its nucleon number.
+		/// \param[in] coefficient Its coefficient.
+		CompactElement(SymbolId symbol, int nucleons, double coefficient);
+
+		/// Creates an element with the data of another element.
+		/// Its symbol is registered if unknown, see cfp::symbolId.
+		explicit 
+		CompactElement(const CompoundElementInterface& e);
+
+		/// Returns the symbol.
+		/// \sa setSymbol, symbolId
+		std::string 
+		symbol(void) const;
+
+		/// Sets the symbol. It is registered if unknown, see 
+		/// cfp::symbolId.
+		/// \param[in] s The new symbol of the element.
+		/// \sa symbol, setSymbolId
+		void 
+		setSymbol(const std::string& s);
+
+		/// Returns the id of the symbol.
+		SymbolId 
+		symbolId(void) const;
+
+		/// Sets the symbol by its id.
+		void 
+		setSymbolId(SymbolId id);
+
+		/// \see ChemicalElementInterface::nucleons
+		int 
+		nucleons(void) const;
+
+		/// \see ChemicalElementInterface::setNucleons
+		void 
+		setNucleons(int i);
+
+		/// \see ChemicalElementInterface::isIsotope
+		bool 
+		isIsotope(void) const;
+
+		/// \see CompoundElementInterface::coefficient
+		double 
+		coefficient(void) const;
+
+		/// \see CompoundElementInterface::setCoefficient
+		void 
+		setCoefficient(double coefficient);
+
+		/// \see ChemicalElementInterface::toString
+		std::string 
+		toString(void) const;
+
+		/// \see ChemicalElementInterface::toMarkup
+		std::string 
+		toMarkup(void) const;
+
+		/// \see ChemicalElementInterface::operator<
+		bool 
+		operator<(const CompactElement& e) const;
+
+	private:
+		SymbolId mSymbol;      //!< Id of the symbol.
+		int      mNucleons;    //!< Nucleon number.
+		double   mCoefficient; //!< Compound coefficient.
+	};
+
+	/**
+	 * Contiguous result type of parsing a formula.
+	 * Alternative to Compound which stores CompactElement objects in a
+	 * single array. Up to 8 elements are stored within the object itself,
+	 * larger compounds allocate their storage on the heap.
+	 * The elements are sorted lexically (see CompactElement::operator<),
+	 * find() looks them up by binary search.
+	 * \sa Parser::compactEmpirical, toCompound
+	 */
+	class CompactCompound
+	{
+	public:
+		/// Iterator over the elements, in lexical order.
+		typedef const CompactElement * const_iterator;
+
+		CompactCompound(); //!< Creates an empty compound.
+
+		/// Copy constructor.
+		CompactCompound(const CompactCompound& c);
+
+		~CompactCompound(); //!< Destructor.
+
+		/// Copies the elements of another compound.
+		CompactCompound& 
+		operator=(const CompactCompound& c);
+
+		/// Returns the number of elements.
+		size_t 
+		size(void) const;
+
+		/// Returns true, if there are no elements.
+		bool 
+		empty(void) const;
+
+		/// Returns the first element.
+		const_iterator 
+		begin(void) const;
+
+		/// Returns the position after the last element.
+		const_iterator 
+		end(void) const;
+
+		/// Returns an element by index.
+		const CompactElement& 
+		operator[](size_t i) const;
+
+		/// Looks up an element by binary search.
+		/// \param[in] symbol   Id of the symbol, see cfp::symbolId.
+		/// \param[in] nucleons The nucleon number, the natural one by
+		///                     default.
+		/// \returns The element or end(), if not found.
+		const_iterator 
+		find(SymbolId symbol, 
+		     int nucleons = ChemicalElementInterface::naturalNucleonNr()) const;
+
+		/// Looks up an element by binary search.
+		/// <em>Provided for convenience.</em> Unknown symbols are not
+		/// registered, see cfp::symbolId.
+		/// \param[in] symbol   The symbol.
+		/// \param[in] nucleons The nucleon number, the natural one by
+		///                     default.
+		/// \returns The element or end(), if not found.
+		const_iterator 
+		find(const std::string& symbol, 
+		     int nucleons = ChemicalElementInterface::naturalNucleonNr()) const;
+
+		/// Removes all elements.
+		void 
+		clear(void);
+
+		/// Replaces the elements.
+		/// \param[in] first The first element to copy.
+		/// \param[in] count Number of elements to copy.
+		/// \param[in] sorted True, if the elements are in lexical order
+		///                   already. They are sorted otherwise.
+		void 
+		assign(const CompactElement * first, size_t count, bool sorted = false);
+
+		/// Converts to the list based result type.
+		/// \param[out] c Its previous elements are replaced.
+		void 
+		toCompound(Compound& c) const;
+
+		/// Converts to the list based result type.
+		/// <em>Provided for convenience.</em>
+		Compound 
+		toCompound(void) const;
+
+	private:
+		/// Number of elements stored without heap allocation.
+		enum { INLINE_CAPACITY = 8 };
+
+		/// Makes room for at least \e n elements, discards the elements.
+		void 
+		reserveDiscard(size_t n);
+
+		CompactElement   mInline[INLINE_CAPACITY]; //!< Inline storage.
+		CompactElement * mData;     //!< Current storage, mInline or heap.
+		size_t           mSize;     //!< Number of elements.
+		size_t           mCapacity; //!< Number of elements fitting into mData.
+	};
+
+	/// A formula referenced in place, without copying it.
+	/// \sa Parser::parseBatch
+	struct FormulaView
+	{
+		const char * str; //!< First character of the formula.
+		size_t       len; //!< Number of characters of the formula.
+	};
+
+	/**
+	 * Columnar result of parsing many formulas at once.
+	 * Each column is a contiguous array. The per formula columns have 
+	 * one entry for each formula, in the order of the input. The 
+	 * elements of all formulas are stored in the element columns, one 
+	 * after another; the elements of formula \e i are found at the 
+	 * indices <tt>offsets[i]</tt> up to <tt>offsets[i+1]-1</tt>.
+	 * Erroneous formulas have no elements.
+	 * The memory of the columns is reused if the result is passed to
+	 * Parser::parseBatch again.
+	 * \sa Parser::parseBatch
+	 */
+	struct BatchResult
+	{
+		/// Index of the first element of each formula, one more entry 
+		/// than formulas. The last entry is the total number of elements.
+		std::vector<size_t>    offsets;
+
+		/// Outcome of each formula, ERROR_NONE if it was parsed.
+		std::vector<ErrorCode> status;
+
+		/// Start of the erroneous section of each formula, 0 if valid.
+		std::vector<size_t>    errorStart;
+
+		/// Length of the erroneous section of each formula, 0 if valid.
+		std::vector<size_t>    errorLength;
+
+		/// Symbol ids of the elements, see cfp::symbolString.
+		std::vector<SymbolId>  symbols;
+
+		/// Nucleon numbers of the elements.
+		std::vector<int>       nucleons;
+
+		/// Coefficients of the elements.
+		std::vector<double>    coefficients;
+
+		/// Returns the number of formulas.
+		size_t 
+		size(void) const;
+
+		/// Removes all formulas, keeps the memory allocated.
+		void 
+		clear(void);
+
+		/// Appends the formulas of another result.
+		/// \param[in] r The result to append, its offsets are adjusted.
+		void 
+		append(const BatchResult& r);
+	};
+
+	/**
+	 * All errors of many formulas, found by Parser::diagnoseBatch.
+	 * The errors of formula \e i are found at the indices 
+	 * <tt>offsets[i]</tt> up to <tt>offsets[i+1]-1</tt> of diagnostics,
+	 * ordered by position. Valid formulas have none.
+	 * The memory is reused if passed to Parser::diagnoseBatch again.
+	 * \sa Parser::diagnose
+	 */
+	struct BatchDiagnostics
+	{
+		/// Index of the first error of each formula, one more entry 
+		/// than formulas. The last entry is the total number of errors.
+		std::vector<size_t> offsets;
+
+		/// The errors of all formulas.
+		std::vector<Status> diagnostics;
+
+		/// Returns the number of formulas.
+		size_t 
+		size(void) const;
+
+		/// Removes all formulas, keeps the memory allocated.
+		void 
+		clear(void);
+	};
+
+	/**
+	 * Receives the results of Parser::parseFile piece by piece.
+	 * consume() is called for consecutive chunks of lines, in the order
+	 * of the file and never concurrently. The arguments are valid during
+	 * the call only; the views point into the mapped file.
+	 * \sa Parser::parseFile
+	 */
+	class BatchSink
+	{
+	public:
+		virtual ~BatchSink(); //!< Destructor.
+
+		/// Takes the results of a chunk of lines.
+		/// \param[in] firstLine Zero based number of the first line of
+		///                      the chunk within the file.
+		/// \param[in] ids       The ID column of each line, NULL if the
+		///                      file has no ID column.
+		/// \param[in] formulas  The formula column of each line.
+		/// \param[in] result    The results of the lines, one formula
+		///                      per line. Error positions are relative
+		///                      to the formula column of the line.
+		virtual void 
+		consume(size_t firstLine, const FormulaView * ids, 
+		        const FormulaView * formulas, const BatchResult& result) = 0;
+	};
+
+	class FormulaCacheData; //!< FormulaCache implementation data structure.
+
+	/**
+	 * Bounded cache of parse results, keyed by the formula.
+	 * A Parser in empirical-only mode, and the batch functions, look up
+	 * each formula in the cache attached by Parser::setCache before 
+	 * parsing it. The results of successfully parsed formulas are stored,
+	 * so repeated formulas cost a hash lookup only. Erroneous formulas
+	 * are not cached.
+	 * The settings of a Parser are part of the key, so a cache may be
+	 * shared by Parsers with different settings. It may be used by 
+	 * several threads at the same time.
+	 * When full, entries not used recently are replaced.
+	 * \sa Parser::setCache
+	 */
+	class FormulaCache
+	{
+	public:
+		/// Counters of a FormulaCache.
+		struct Statistics
+		{
+			size_t size;      //!< Number of cached formulas.
+			size_t hits;      //!< Lookups which found the formula.
+			size_t misses;    //!< Lookups which did not find it.
+			size_t evictions; //!< Entries replaced because of capacity.
+		};
+
+		/// Creates an empty cache.
+		/// \param[in] capacity Maximum number of cached formulas.
+		explicit FormulaCache(size_t capacity = 4096);
+
+		~FormulaCache(); //!< Destructor.
+
+		/// Returns the maximum number of cached formulas.
+		size_t 
+		capacity(void) const;
+
+		/// Returns the current counters.
+		Statistics 
+		statistics(void) const;
+
+		/// Removes all formulas and resets the counters.
+		void 
+		clear(void);
+
+	private:
+		FormulaCache(const FormulaCache&);            //!< Not copyable.
+		FormulaCache& operator=(const FormulaCache&); //!< Not copyable.
+
+		friend class Parser;
+		FormulaCacheData * mD; //!< Implementation data.
+	};
+
 	class ParserState; //!< Parser implementation data structure.
 
 	/**
@@ -313,15 +755,122 @@ namespace cfp
 	 *   - setFormula(const std::string&), 
 	 *   - process(const char *, const size_t)
 	 *
+	 *   These copy the formula. To parse it in place instead, without 
+	 *   allocating and copying, use
+	 *   - setFormulaView(const char *, const size_t),
+	 *   - processView(const char *, const size_t)
+	 *
 	 * - For output it provides a list of CompoundElement objects which represents
 	 *   the empirical chemical formula (each element or isotope of an
 	 *   element occurs only once)
 	 *   - process(const char *, const size_t),
 	 *   - empirical()
+	 *
+	 * - Many formulas are parsed at once into a columnar BatchResult by
+	 *   - parseBatch(const FormulaView *, size_t, BatchResult&)
+	 *   - parseBatchParallel(const FormulaView *, size_t, BatchResult&, size_t)
+	 *   - parseFile(const char *, BatchSink&, char, size_t) for files with
+	 *     one formula per line
+	 *
+	 * - Errors are thrown as cfp::Error. The functions starting with 
+	 *   \e try return a cfp::Status instead and do not throw parse errors,
+	 *   they work without exception support, too.
+	 *   - tryProcess(void), tryProcess(const char *, const size_t),
+	 *     tryProcessView(const char *, const size_t)
+	 *   - tryParseFile(const char *, BatchSink&, char, size_t)
+	 *
+	 * - A formula changed in place, e.g. by typing into an editor, is
+	 *   parsed again reusing the unchanged part of the previous result by
+	 *   - edit(size_t, size_t, const char *, size_t),
+	 *     tryEdit(size_t, size_t, const char *, size_t)
+	 *
+	 * - Formulas are checked without building a result by
+	 *   - validate(const char *, const size_t)
+	 *   - validateBatch(const FormulaView *, size_t, std::vector<Status>&)
+	 *
+	 * - All errors of a formula are found at once, instead of the first
+	 *   one only, by
+	 *   - diagnose(std::vector<Status>&), 
+	 *     diagnoseView(const char *, const size_t, std::vector<Status>&)
+	 *   - diagnoseBatch(const FormulaView *, size_t, BatchDiagnostics&)
+	 *
+	 * - Counters of the work done, e.g. for monitoring, are provided by
+	 *   - statistics(), resetStatistics(), setStageTiming(bool)
+	 *
+	 * Parser objects do not share mutable state, except for the 
+	 * internally synchronized symbol table (see symbolId() ). Different
+	 * Parser objects may be used by different threads at the same time
+	 * without locking. A single Parser, including its const member
+	 * functions, must be used by one thread at a time.
+	 * The library does not write to any stream, errors are reported by
+	 * exceptions or cfp::Status only.
 	 */
 	class Parser
 	{
 	public:
+		/**
+		 * Counters of the work done by a Parser since its creation or
+		 * resetStatistics(). The batch and file functions add the 
+		 * counters of their worker threads. Statistics of several 
+		 * Parsers, e.g. one per thread, are summed up by operator+=.
+		 * Without statistics support (cmake -DWITH_STATISTICS=OFF), the
+		 * counters are removed at compile time and stay zero.
+		 * \sa Parser::statistics
+		 */
+		struct Statistics
+		{
+			/// Stages of parsing, timed if enabled by setStageTiming().
+			typedef enum {
+				STAGE_INDEX,    //!< Classification of the characters.
+				STAGE_PARSE,    //!< Lexer and grammar, building the tree.
+				STAGE_FLATTEN,  //!< Accumulation of the empirical formula.
+				STAGE_VALIDATE, //!< All of validate().
+				STAGE_COUNT     //!< Number of stages.
+			} Stage;
+
+			/// Kinds of tokens, in the order of Token::Type.
+			typedef enum {
+				TOKEN_SYMBOL, //!< Element symbols.
+				TOKEN_GROUP,  //!< Groups closed by a bracket.
+				TOKEN_INT,    //!< Natural numbers.
+				TOKEN_FLOAT,  //!< Real numbers.
+				TOKEN_COUNT   //!< Number of kinds.
+			} TokenType;
+
+			size_t formulas;       //!< Formulas parsed or validated.
+			size_t characters;     //!< Characters of the formulas scanned.
+			size_t tokens[TOKEN_COUNT]; //!< Tokens by kind, not counted
+			                            //!< by validate().
+			size_t groups;         //!< Groups opened.
+			size_t maxDepth;       //!< Deepest nesting level reached.
+			size_t treeNodes;      //!< Nodes of element trees flattened,
+			                       //!< elements and groups.
+			size_t mergedElements; //!< Elements combined with an equal 
+			                       //!< one of the empirical formula.
+			size_t errors[ERROR_CODE_COUNT]; //!< Errors by ErrorCode.
+			/// Approximate growth of the buffers a Parser reuses for
+			/// subsequent formulas, like nodes and nesting levels.
+			size_t allocatedBytes;
+			/// Duration of each stage, in nanoseconds.
+			uint64_t nanoseconds[STAGE_COUNT];
+
+			/// Creates zero counters.
+			Statistics();
+
+			/// Sets all counters to zero.
+			void 
+			clear(void);
+
+			/// Adds the counters of \e s, maxDepth becomes the larger 
+			/// one of both.
+			Statistics& 
+			operator+=(const Statistics& s);
+
+			/// Tells if the library collects statistics.
+			static bool 
+			available(void);
+		};
+
 		/// Default constructor.
 		Parser(void);
 
@@ -336,6 +885,27 @@ namespace cfp
 
 		~Parser(); //!< Destructor.
 
+		/// Copies all data of another Parser, including its formula
+		/// and result.
+		/// \param[in] p Parser to copy all data from.
+		/// \returns A reference to \e this Parser.
+		Parser& 
+		operator=(const Parser& p);
+
+#ifdef CFP_HAS_MOVE
+		/// Move constructor. Takes over the data of \e p without 
+		/// copying, \e p may only be assigned to or destroyed afterwards.
+		Parser(Parser&& p) noexcept;
+
+		/// Move assignment. Exchanges the data with \e p.
+		Parser& 
+		operator=(Parser&& p) noexcept;
+#endif
+
+		/// Exchanges the data of two Parsers in constant time.
+		void 
+		swap(Parser& p) throw();
+
 		/// Sets the input formula of this Parser.
 		/// \param[in] formula The new input formula C-style string.
 		/// \param[in] len     Number of characters in \e formula.
@@ -346,7 +916,18 @@ namespace cfp
 		/// \param[in] formula The new input formula string.
 		void setFormula(const std::string& formula);
 
+		/// Sets the input formula of this Parser without copying it.
+		/// The formula is parsed in place from the supplied buffer, which
+		/// may be memory mapped or a network buffer. It has to stay 
+		/// valid and unmodified until process() returned.
+		/// \param[in] formula The new input formula C-style string.
+		/// \param[in] len     Number of characters in \e formula.
+		/// \sa processView, formula
+		void setFormulaView(const char * formula, const size_t len);
+
 		/// Returns the current formula of this Parser.
+		/// If it was set by setFormulaView(), a copy is created at the 
+		/// first call. The buffer has to be still valid at that time.
 		const std::string& formula() const;
 
 		/// Parses the current formula of this Parser.
@@ -364,14 +945,213 @@ namespace cfp
 		/// \sa setFormula, process, empirical
 		const Compound& process(const char * formula, const size_t len);
 
+		/// Parses the given formula in place and returns the result.
+		/// Same as process(const char *, const size_t) but the formula is
+		/// not copied, see setFormulaView().
+		/// \note May throw a cfp::Error or any of its sub-classes.
+		/// \param[in] formula The new input formula C-style string.
+		/// \param[in] len     Number of characters in \e formula.
+		/// \returns The empirical representation of the supplied formula.
+		/// \sa setFormulaView, process, empirical
+		const Compound& processView(const char * formula, const size_t len);
+
+		/// Parses the current formula of this Parser without throwing.
+		/// Same as process() but parse errors are returned. No memory
+		/// is allocated for reporting an error.
+		/// \returns The outcome, Status::ok() if the formula is valid.
+		///          Otherwise, empirical() is undefined until the next
+		///          successful call.
+		/// \sa process(void), throwError
+		Status tryProcess(void);
+
+		/// Parses the given formula without throwing.
+		/// \param[in] formula The new input formula C-style string.
+		/// \param[in] len     Number of characters in \e formula.
+		/// \sa tryProcess(void), process(const char *, const size_t)
+		Status tryProcess(const char * formula, const size_t len);
+
+		/// Parses the given formula in place without throwing.
+		/// \param[in] formula The new input formula C-style string.
+		/// \param[in] len     Number of characters in \e formula.
+		/// \sa tryProcess(void), processView
+		Status tryProcessView(const char * formula, const size_t len);
+
+		/// Replaces characters of the current formula and parses it.
+		/// The formula is copied first if it was set by 
+		/// setFormulaView(). The result is the same as of process() for 
+		/// the new formula, but after a successful edit() or tryEdit() 
+		/// with the same settings, only the part of the formula from the
+		/// top level item containing the edit up to the first unchanged
+		/// item behind it is parsed again. A group containing the edit 
+		/// is parsed again as a whole. The elements are summed up again
+		/// in any case. In empiricalOnly() mode, it is the same as 
+		/// changing the formula and calling process().
+		/// \note May throw a cfp::Error or any of its sub-classes.
+		/// \param[in] offset  Position of the first character to replace,
+		///                    at most the length of the formula.
+		/// \param[in] removed Number of characters to remove, up to the 
+		///                    end of the formula.
+		/// \param[in] text    Characters to insert instead, may be NULL.
+		/// \param[in] len     Number of characters of \e text.
+		/// \returns The empirical representation of the new formula.
+		/// \sa tryEdit, formula
+		const Compound& edit(size_t offset, size_t removed, 
+		                     const char * text, size_t len);
+
+		/// Same as edit() but parse errors are returned.
+		/// \returns The outcome, Status::ok() if the new formula is valid.
+		///          Otherwise, empirical() is undefined until the next
+		///          successful call.
+		/// \sa edit, tryProcess(void)
+		Status tryEdit(size_t offset, size_t removed, 
+		               const char * text, size_t len);
+
+		/// Checks the syntax of a formula without building a result.
+		/// Only the lexer and the grammar of tryProcess() are run, no
+		/// elements or groups are created and no memory is allocated 
+		/// once the Parser saw a formula of similar nesting depth. The
+		/// formula is not copied. The formula and the result of this 
+		/// Parser are not changed.
+		/// \param[in] formula The formula C-style string to check.
+		/// \param[in] len     Number of characters in \e formula.
+		/// \returns The same status as tryProcess() with the settings of
+		///          this Parser.
+		/// \sa validateBatch
+		Status validate(const char * formula, const size_t len);
+
+		/// Checks the syntax of many formulas, see validate().
+		/// \param[in]  formulas The formulas to check.
+		/// \param[in]  count    Number of formulas.
+		/// \param[out] result   The status of each formula, its previous
+		///                      content is replaced.
+		void validateBatch(const FormulaView * formulas, size_t count, 
+		                   std::vector<Status>& result);
+
+		/// Parses the current formula and reports all of its errors.
+		/// Unlike tryProcess(), parsing resynchronizes after an error 
+		/// and goes on in the same pass:
+		/// - a run of invalid characters, of lower case characters 
+		///   beginning a symbol or of misplaced decimal separators is 
+		///   reported once and skipped, it ends the preceding token;
+		/// - a closing bracket without opening one is skipped;
+		/// - groups still open at the end are reported and closed;
+		/// - the bracket exceeding maxNestingLevel() is reported, deeper
+		///   groups are parsed as usual;
+		/// - unknown symbols, a leading coefficient and lone nucleon 
+		///   numbers are reported and dropped.
+		///
+		/// The first error by position is the same as reported by 
+		/// tryProcess() for most formulas; the length of a skipped run 
+		/// covers all of its characters, though.
+		/// \param[out] diagnostics The errors are appended, ordered by
+		///                         position.
+		/// \returns The number of errors, 0 if the formula is valid. 
+		///          Otherwise, empirical() is undefined until the next
+		///          successful call.
+		/// \sa tryProcess
+		size_t diagnose(std::vector<Status>& diagnostics);
+
+		/// Parses the given formula in place and reports all of its 
+		/// errors, see diagnose().
+		/// \param[in]  formula     The new input formula C-style string.
+		/// \param[in]  len         Number of characters in \e formula.
+		/// \param[out] diagnostics The errors are appended.
+		/// \returns The number of errors.
+		size_t diagnoseView(const char * formula, const size_t len, 
+		                    std::vector<Status>& diagnostics);
+
+		/// Reports all errors of many formulas, as diagnose() in 
+		/// empirical-only mode. Afterwards, empirical() and formula()
+		/// of this Parser are empty.
+		/// \param[in]  formulas The formulas to check.
+		/// \param[in]  count    Number of formulas.
+		/// \param[out] result   Its previous content is replaced.
+		/// \sa BatchDiagnostics
+		void diagnoseBatch(const FormulaView * formulas, size_t count, 
+		                   BatchDiagnostics& result);
+
 		/// Returns the result of the most recent parsing operation.
 		/// \returns The empirical representation of the supplied formula.
 		const Compound& empirical(void) const;
 
+		/// Parses many formulas into a single columnar result.
+		/// Each formula is parsed as by processView() with the settings
+		/// of this Parser, in empirical-only mode. Errors do not stop the
+		/// batch, they are recorded in the status columns instead. 
+		/// Afterwards, empirical() and formula() of this Parser are 
+		/// empty.
+		/// \param[in]  formulas The formulas to parse.
+		/// \param[in]  count    Number of formulas.
+		/// \param[out] result   Its previous content is replaced.
+		/// \sa BatchResult
+		void parseBatch(const FormulaView * formulas, size_t count, 
+		                BatchResult& result);
+
+		/// Parses many formulas in parallel into a single columnar result.
+		/// The result is the same as the one of parseBatch(). The 
+		/// formulas are split into chunks which are distributed among
+		/// the threads; idle threads take over chunks of busy ones. Each
+		/// thread uses its own copy of this Parser and its own output, 
+		/// which are joined in the order of the input at the end.
+		/// \param[in]  formulas The formulas to parse.
+		/// \param[in]  count    Number of formulas.
+		/// \param[out] result   Its previous content is replaced.
+		/// \param[in]  threads  Number of threads to use, including the
+		///                      calling one. 0 for one per processor core.
+		/// \sa parseBatch, BatchResult
+		void parseBatchParallel(const FormulaView * formulas, size_t count, 
+		                        BatchResult& result, 
+		                        size_t threads = 0) const;
+
+		/// Parses a file with one formula per line in parallel and 
+		/// streams the results to \e sink.
+		/// The file is memory mapped and split into chunks at line 
+		/// boundaries, the lines are parsed in place as by parseBatch().
+		/// Lines end with LF or CR LF, every line is a formula, an empty
+		/// one for empty lines. Optionally, each line starts with an ID,
+		/// separated from the formula by the first \e idSeparator.
+		/// Lines without separator have an empty ID.
+		/// \note Throws ErrorFileAccess if the file can not be read and 
+		///       passes on exceptions of \e sink. 
+		/// \param[in] path        The file to parse.
+		/// \param[in] sink        Receives the results in file order.
+		/// \param[in] idSeparator Character after the ID column, 0 if 
+		///                        the lines contain the formula only.
+		/// \param[in] threads     Number of threads to use, including the
+		///                        calling one. 0 for one per processor core.
+		/// \sa BatchSink, parseBatchParallel
+		void parseFile(const char * path, BatchSink& sink, 
+		               char idSeparator = 0, size_t threads = 0) const;
+
+		/// Same as parseFile(const char *, BatchSink&, char, size_t) but
+		/// returns ERROR_FILE_ACCESS if the file can not be read, 
+		/// instead of throwing.
+		/// \returns The outcome, parse errors of the lines are in the 
+		///          results passed to \e sink.
+		Status tryParseFile(const char * path, BatchSink& sink, 
+		                    char idSeparator = 0, size_t threads = 0) const;
+
+		/// Parses a file with one formula per line into a single 
+		/// columnar result. The formula of line \e i is at index \e i.
+		/// <em>Provided for convenience.</em>
+		/// \sa parseFile(const char *, BatchSink&, char, size_t)
+		void parseFile(const char * path, BatchResult& result, 
+		               char idSeparator = 0, size_t threads = 0) const;
+
+		/// Returns the result of the most recent parsing operation as 
+		/// contiguous array. The elements are in lexical order 
+		/// regardless of elementOrder().
+		/// \returns The empirical representation of the supplied formula.
+		/// \sa empirical
+		const CompactCompound& compactEmpirical(void) const;
+
 		/// String representation of the parsed Formula with markup text
 		/// formatting. This includes \<sup\> for the nucleon number
 		/// and \<sub\> for the coefficient value.
+		/// In empirical-only mode, the structure of the formula is not
+		/// known, the empirical formula is formatted instead.
 		/// \returns The formatted string.
+		/// \sa setEmpiricalOnly
 		std::string toMarkup(void) const;
 
 		/// Sets the maximum nesting level within the supplied formulas.
@@ -387,6 +1167,73 @@ namespace cfp
 		/// \sa setMaxNestingLevel
 		size_t maxNestingLevel(void) const;
 
+		/// Enables the strict symbol mode. If enabled, only symbols of 
+		/// the periodic table are accepted and an ErrorUnknownSymbol is 
+		/// thrown during Parser::process for all others. The default is 
+		/// disabled.
+		/// \param[in] strict True to enable the strict mode.
+		/// \sa strictSymbols
+		void setStrictSymbols(bool strict);
+
+		/// Tells if the strict symbol mode is enabled.
+		/// \sa setStrictSymbols
+		bool strictSymbols(void) const;
+
+		/// Sets the order of the elements returned by empirical() for
+		/// subsequently processed formulas. The default is ORDER_LEXICAL.
+		/// \param[in] order The new order.
+		/// \sa elementOrder
+		void setElementOrder(ElementOrder order);
+
+		/// Returns the order of the elements returned by empirical().
+		/// \sa setElementOrder
+		ElementOrder elementOrder(void) const;
+
+		/// Enables the empirical-only mode. If enabled, the empirical
+		/// formula is accumulated in a single pass while parsing, 
+		/// without building a representation of the formula structure.
+		/// This is faster for callers which need empirical() only.
+		/// The coefficients are bit-identical to those of the default
+		/// mode. The default is disabled.
+		/// \param[in] empiricalOnly True to enable the mode.
+		/// \sa empiricalOnly, toMarkup
+		void setEmpiricalOnly(bool empiricalOnly);
+
+		/// Tells if the empirical-only mode is enabled.
+		/// \sa setEmpiricalOnly
+		bool empiricalOnly(void) const;
+
+		/// Attaches a cache of parse results. It is used in 
+		/// empirical-only mode and by the batch functions only. The 
+		/// cache is not owned, it has to outlive this Parser and its 
+		/// copies, which share it. The default is no cache.
+		/// \param[in] cache The cache to use, NULL for none.
+		/// \sa cache, FormulaCache
+		void setCache(FormulaCache * cache);
+
+		/// Returns the attached cache, NULL if there is none.
+		/// \sa setCache
+		FormulaCache * cache(void) const;
+
+		/// Returns the counters of the work done by this Parser. A copy
+		/// of a Parser starts with zero counters.
+		/// \sa Statistics, resetStatistics
+		const Statistics& statistics(void) const;
+
+		/// Sets all counters of statistics() to zero.
+		void resetStatistics(void);
+
+		/// Enables measuring the duration of the parsing stages, see 
+		/// Statistics::nanoseconds. It costs reading a clock twice per
+		/// stage and formula. The default is disabled.
+		/// \param[in] timing True to enable the measurement.
+		/// \sa stageTiming
+		void setStageTiming(bool timing);
+
+		/// Tells if the duration of the parsing stages is measured.
+		/// \sa setStageTiming
+		bool stageTiming(void) const;
+
 	private:
 		ParserState * mD; //!< Implementation data.
 	};
@@ -407,6 +1254,18 @@ namespace cfp
 	 */
 	std::string toString(const cfp::Compound& el);
 
+	/// Exchanges two elements in constant time, see ChemicalElement::swap.
+	inline void 
+	swap(ChemicalElement& a, ChemicalElement& b) throw() { a.swap(b); }
+
+	/// Exchanges two elements in constant time, see CompoundElement::swap.
+	inline void 
+	swap(CompoundElement& a, CompoundElement& b) throw() { a.swap(b); }
+
+	/// Exchanges two Parsers in constant time, see Parser::swap.
+	inline void 
+	swap(Parser& a, Parser& b) throw() { a.swap(b); }
+
 } // namespace cfp
 
 namespace std
@@ -421,6 +1280,17 @@ namespace std
 	std::ostream& 
 	operator<<(std::ostream& o, const cfp::ChemicalElementInterface& e);
 
+	/**
+	 * Writes the string representation of a CompactElement to an output 
+	 * stream.
+	 * \param[in,out] o Output stream to write to.
+	 * \param[in]     e CompactElement to create a string representation from.
+	 * \returns         The output stream o.
+	 * \relatesalso cfp::CompactElement
+	 */
+	std::ostream& 
+	operator<<(std::ostream& o, const cfp::CompactElement& e);
+
 	/**
 	 * Writes the string representation of an Compound to an output 
 	 * stream.
@@ -430,6 +1300,17 @@ namespace std
 	 */
 	std::ostream& 
 	operator<<(std::ostream& o, const cfp::Compound& el);
+
+	/**
+	 * Writes the string representation of a CompactCompound to an output 
+	 * stream. The format is the same as for a Compound.
+	 * \param[in,out] o  Output stream to write to.
+	 * \param[in]     el CompactCompound to create a string representation from.
+	 * \returns          The output stream o.
+	 * \relatesalso cfp::CompactCompound
+	 */
+	std::ostream& 
+	operator<<(std::ostream& o, const cfp::CompactCompound& el);
 }
 
 #endif // this file
@@ -30,9 +30,67 @@
 #include <exception>
 #include <string>
 
+/// Defined, if the compiler does not support exceptions, for example 
+/// with -fno-exceptions. The library is usable by the non-throwing 
+/// functions then, see cfp::Status.
+#if !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+	#define CFP_NO_EXCEPTIONS
+#endif
+
 namespace cfp
 {
 
+	/// Identifies the kind of a parse error.
+	/// \sa Error::code
+	typedef enum {
+		ERROR_NONE = 0,                //!< No error occurred.
+		ERROR_GENERIC,                 //!< An Error of unspecified kind.
+		ERROR_INVALID_CHAR,            //!< See ErrorInvalidChar.
+		ERROR_SYM_BEG_LOW_CHAR,        //!< See ErrorSymBegLowChar.
+		ERROR_DECIM_BETW_INT,          //!< See ErrorDecimBetwInt.
+		ERROR_MAX_NESTING,             //!< See ErrorMaxNesting.
+		ERROR_START_WITH_COEF,         //!< See ErrorStartWithCoef.
+		ERROR_LONE_NUCLEON_NUM,        //!< See ErrorLoneNucleonNum.
+		ERROR_LONE_CLOSING_BRACKET,    //!< See ErrorLoneClosingBracket.
+		ERROR_MISSING_CLOSING_BRACKET, //!< See ErrorMissingClosingBracket.
+		ERROR_UNKNOWN_SYMBOL,          //!< See ErrorUnknownSymbol.
+		ERROR_FILE_ACCESS,             //!< See ErrorFileAccess.
+		ERROR_CODE_COUNT               //!< Number of error codes.
+	} ErrorCode;
+
+	/// Returns the description of a kind of error.
+	/// \param[in] code The kind of error.
+	/// \returns A static C-style string, it is not copied.
+	const char * 
+	errorMessage(ErrorCode code);
+
+	/**
+	 * Outcome of parsing a formula, returned by the non-throwing 
+	 * functions like Parser::tryProcess instead of throwing an Error.
+	 * It is a plain value, no memory is allocated for the message.
+	 */
+	struct Status
+	{
+		ErrorCode code;   //!< Kind of the error, ERROR_NONE on success.
+		size_t    start;  //!< First position of the erroneous section.
+		size_t    length; //!< Length of the erroneous section.
+
+		/// Tells if there was no error.
+		bool 
+		ok(void) const { return code == ERROR_NONE; }
+
+		/// Returns the description of the error, see errorMessage().
+		const char * 
+		message(void) const { return errorMessage(code); }
+	};
+
+	/// Throws the Error sub-class of a status, unless it is ERROR_NONE.
+	/// Without exception support ( CFP_NO_EXCEPTIONS ), the program is 
+	/// aborted instead.
+	/// \param[in] status The status to convert.
+	void 
+	throwError(const Status& status);
+
 	/// Parse error base class.
 	class Error: public std::exception
 	{
@@ -91,6 +149,14 @@ namespace cfp
 		virtual const std::string&
 		whatStr(size_t& start, size_t& length) const throw();
 
+		/**
+		 * Provides the kind of the current error.
+		 * \returns The code of the sub-class, ERROR_GENERIC for this 
+		 *          class.
+		 */
+		ErrorCode
+		code(void) const throw();
+
 	protected:
 		/**
 		 * Creates a parse error with a message.
@@ -102,6 +168,16 @@ namespace cfp
 		explicit
 		Error(const std::string& msg, size_t start, size_t length);
 
+		/**
+		 * Creates a parse error of a specific kind with a message.
+		 * \param[in] code Kind of this error.
+		 * \param[in] msg Description of this error.
+		 * \param[in] start Start position of the erroneous section in the parsed
+		 *              string.
+		 * \param[in] length Length of the erroneous section in the parsed string.
+		 */
+		Error(ErrorCode code, const std::string& msg, size_t start, size_t length);
+
 		/**
 		 * Sets the message of this error.
 		 * \param msg The message string.
@@ -112,6 +188,7 @@ namespace cfp
 		std::string msg_m;    //!< Description of this error.
 		size_t      start_m;  //!< First position of the erroneous section.
 		size_t      length_m; //!< Length of the erroneous section.
+		ErrorCode   code_m;   //!< Kind of this error.
 	};
 
 
@@ -120,8 +197,9 @@ namespace cfp
 	{
 	public:
 		explicit ErrorInvalidChar(size_t start, size_t length)
-			: Error("Invalid Character !", 
-			        start, length)
+			: Error(ERROR_INVALID_CHAR,
+				errorMessage(ERROR_INVALID_CHAR),
+				start, length)
 		{}
 	};
 
@@ -130,7 +208,8 @@ namespace cfp
 	{
 	public:
 		explicit ErrorSymBegLowChar(size_t start, size_t length)
-			: Error("Symbols must not begin with lower case characters !", 
+			: Error(ERROR_SYM_BEG_LOW_CHAR,
+				errorMessage(ERROR_SYM_BEG_LOW_CHAR),
 				start, length)
 		{}
 	};
@@ -143,7 +222,8 @@ namespace cfp
 	{
 	public:
 		explicit ErrorDecimBetwInt(size_t start, size_t length)
-			: Error("Decimal operator only between numerical characters allowed !",
+			: Error(ERROR_DECIM_BETW_INT,
+				errorMessage(ERROR_DECIM_BETW_INT),
 				start, length)
 		{}
 	};
@@ -154,7 +234,8 @@ namespace cfp
 	{
 	public:
 		explicit ErrorMaxNesting(size_t start, size_t length)
-			: Error("Maximum nesting level reached !",
+			: Error(ERROR_MAX_NESTING,
+				errorMessage(ERROR_MAX_NESTING),
 				start, length)
 		{}
 	};
@@ -165,7 +246,8 @@ namespace cfp
 	{
 	public:
 		explicit ErrorStartWithCoef(size_t start, size_t length)
-			: Error("Expression must not begin with floating point value !",
+			: Error(ERROR_START_WITH_COEF,
+				errorMessage(ERROR_START_WITH_COEF),
 				start, length)
 		{}
 	};
@@ -178,7 +260,8 @@ namespace cfp
 	{
 	public:
 		explicit ErrorLoneNucleonNum(size_t start, size_t length)
-			: Error("Nucleon number specified without preceding Element symbol !",
+			: Error(ERROR_LONE_NUCLEON_NUM,
+				errorMessage(ERROR_LONE_NUCLEON_NUM),
 				start, length)
 		{}
 	};
@@ -189,7 +272,21 @@ namespace cfp
 	{
 	public:
 		explicit ErrorLoneClosingBracket(size_t start, size_t length)
-			: Error("Encountered closing bracket without preceding opening bracket !", 
+			: Error(ERROR_LONE_CLOSING_BRACKET,
+				errorMessage(ERROR_LONE_CLOSING_BRACKET),
+				start, length)
+		{}
+	};
+
+
+	/// Error for a symbol which is not in the periodic table.
+	/// Thrown in strict symbol mode only, see Parser::setStrictSymbols.
+	class ErrorUnknownSymbol: public Error
+	{
+	public:
+		explicit ErrorUnknownSymbol(size_t start, size_t length)
+			: Error(ERROR_UNKNOWN_SYMBOL,
+				errorMessage(ERROR_UNKNOWN_SYMBOL),
 				start, length)
 		{}
 	};
@@ -200,11 +297,25 @@ namespace cfp
 	{
 	public:
 		explicit ErrorMissingClosingBracket(size_t start, size_t length)
-			: Error("Missing closing bracket !", 
+			: Error(ERROR_MISSING_CLOSING_BRACKET,
+				errorMessage(ERROR_MISSING_CLOSING_BRACKET),
 				start, length)
 		{}
 	};
 
+
+	/// Error for a formula file which can not be read.
+	/// Thrown by Parser::parseFile, there is no erroneous section.
+	class ErrorFileAccess: public Error
+	{
+	public:
+		ErrorFileAccess(void)
+			: Error(ERROR_FILE_ACCESS,
+				errorMessage(ERROR_FILE_ACCESS),
+				0, 0)
+		{}
+	};
+
 } // namespace cfp
 
 #endif
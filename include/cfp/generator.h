@@ -0,0 +1,196 @@
+/*
+ * include/cfp/generator.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin,
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_GENERATOR_H
+#define CFP_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace cfp
+{
+	/**
+	 * Generator of synthetic formulas for load tests and benchmarks.
+	 * The formulas follow the grammar accepted by Parser::process with
+	 * strict symbols (see Parser::setStrictSymbols), unless they are
+	 * made malformed on purpose. The sequence of formulas depends on the
+	 * seed and the Settings only, it is the same on every platform.
+	 *
+	 * A formula is a sequence of items, optionally separated by spaces.
+	 * An item is an element with optional isotope and count, e.g.
+	 * <tt>13C2</tt>, <tt>H(2)</tt> or <tt>O2.5</tt>, or a group of items
+	 * in brackets with optional coefficient, e.g. <tt>[Fe(CN)6]4</tt>.
+	 * The command line tool cfp_generate writes them to a file.
+	 */
+	class FormulaGenerator
+	{
+	public:
+		/// Notation of isotopes.
+		typedef enum {
+			ISOTOPE_PREFIX, //!< Nucleon number before the symbol: 13C
+			ISOTOPE_SUFFIX, //!< Nucleon number in brackets after it: H(2)
+			ISOTOPE_MIXED   //!< Either one, chosen at random.
+		} IsotopeNotation;
+
+		/// Parameters of the generated formulas.
+		/// Probabilities are in the range [0, 1].
+		struct Settings
+		{
+			/// Mostly organic formulas of 8 to 64 characters, with a
+			/// few groups and isotopes and without errors.
+			Settings();
+
+			/// Element symbols to choose from, known to the Parser.
+			std::vector<std::string> symbols;
+
+			/// Relative frequency of each symbol, all are equally
+			/// frequent if empty.
+			std::vector<double> weights;
+
+			size_t minLength; //!< Minimum number of characters.
+			size_t maxLength; //!< Approximate maximum number of characters,
+			                  //!< the last item may exceed it.
+
+			/// Maximum nesting depth of groups, including the brackets
+			/// of the isotope suffix notation. A Parser accepts them if
+			/// its Parser::maxNestingLevel() is larger.
+			size_t maxDepth;
+
+			/// Chance of an item being a group, if maxDepth is not
+			/// reached yet. 1 nests each group to maxDepth.
+			double groupProbability;
+
+			/// Maximum number of items of a group, at least 1.
+			size_t maxGroupItems;
+
+			/// Chance of a group having a coefficient.
+			double groupCoefficientProbability;
+
+			/// Chance of an element having a count.
+			double countProbability;
+
+			/// Chance of an element being an isotope.
+			double isotopeProbability;
+
+			/// Notation of the isotopes. The prefix notation is not
+			/// possible everywhere, e.g. 13C after H reads H13 C.
+			/// The suffix notation is used there instead.
+			IsotopeNotation isotopeNotation;
+
+			/// Chance of a count or coefficient being a decimal number.
+			double decimalProbability;
+
+			/// Chance of a decimal number using ',' instead of '.'.
+			double commaProbability;
+
+			/// Chance of a space between two items.
+			double spaceProbability;
+
+			/// Fraction of formulas containing a single error, like an
+			/// invalid character or an unbalanced bracket.
+			double malformedFraction;
+		};
+
+		/// Creates a generator of formulas with \e settings.
+		/// \param[in] seed     Start of the sequence.
+		/// \param[in] settings Parameters of the formulas.
+		explicit 
+		FormulaGenerator(uint64_t seed = 0, 
+		                 const Settings& settings = Settings());
+
+		/// Restarts the sequence of formulas at \e seed.
+		void 
+		setSeed(uint64_t seed);
+
+		/// Replaces the parameters of the following formulas.
+		void 
+		setSettings(const Settings& settings);
+
+		/// Returns the parameters of the formulas.
+		const Settings& 
+		settings(void) const;
+
+		/// Generates the next formula.
+		/// \param[out] formula Its previous content is replaced.
+		/// \returns True, if the formula was made malformed.
+		bool 
+		next(std::string& formula);
+
+	private:
+		/// Returns the next number of the random sequence (splitmix64).
+		uint64_t 
+		random(void);
+
+		/// Returns a random number in [0, 1).
+		double 
+		uniform(void);
+
+		/// Returns true with probability \e p.
+		bool 
+		chance(double p);
+
+		/// Returns a random number in [0, n).
+		size_t 
+		below(size_t n);
+
+		/// Appends a count or coefficient, an integer from 2 to 20 or
+		/// a decimal number.
+		void 
+		appendCount(std::string& str);
+
+		/// Appends an element, eventually with isotope and count.
+		/// \param[in,out] str    The formula.
+		/// \param[in]     depth  Nesting depth of the element.
+		/// \param[in]     prefix True, if an isotope in prefix notation
+		///                       is possible, e.g. at the start of a group.
+		/// \returns True, if the element ends with a count.
+		bool 
+		appendElement(std::string& str, size_t depth, bool prefix);
+
+		/// Appends the items of a formula or a group, elements or
+		/// groups, separated by spaces eventually.
+		/// \param[in,out] str      The formula.
+		/// \param[in]     depth    Nesting depth of the items.
+		/// \param[in]     maxItems Maximum number of items.
+		/// \param[in]     length   Target length of the formula, no
+		///                         further items are added beyond it.
+		/// \returns True, if the last item ends with a count.
+		bool 
+		appendItems(std::string& str, size_t depth, size_t maxItems, 
+		            size_t length);
+
+		/// Inserts a single error into a valid formula.
+		void 
+		makeMalformed(std::string& str);
+
+		Settings            mSettings;   //!< Parameters of the formulas.
+		std::vector<double> mCumulative; //!< Cumulated weights of symbols.
+		uint64_t            mState;      //!< State of the random sequence.
+	};
+} // namespace cfp
+
+#endif // this file
@@ -0,0 +1,64 @@
+/*
+ * src/charclass.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include "charclass.h"
+
+#define INV CHAR_INVALID
+#define NUM CHAR_NUM
+#define DEC CHAR_DECIM
+#define UPP CHAR_ALPHA_U
+#define LOW CHAR_ALPHA_L
+#define BRO CHAR_BRACKET_O
+#define BRC CHAR_BRACKET_C
+#define SPC CHAR_SPACE
+
+const unsigned char cfp::charClassTable[256] = {
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0x00
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0x10
+	SPC, INV, INV, INV, INV, INV, INV, INV, BRO, BRC, INV, INV, DEC, INV, DEC, INV, // 0x20
+	NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, INV, INV, INV, INV, INV, INV, // 0x30
+	INV, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, // 0x40
+	UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, UPP, BRO, INV, BRC, INV, INV, // 0x50
+	INV, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, // 0x60
+	LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, LOW, BRO, INV, BRC, INV, INV, // 0x70
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0x80
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0x90
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0xA0
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0xB0
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0xC0
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0xD0
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, // 0xE0
+	INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV, INV  // 0xF0
+};
+
+#undef INV
+#undef NUM
+#undef DEC
+#undef UPP
+#undef LOW
+#undef BRO
+#undef BRC
+#undef SPC
@@ -0,0 +1,61 @@
+/*
+ * src/charclass.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_CHARCLASS_H
+#define CFP_CHARCLASS_H
+
+namespace cfp
+{
+	/// Classes of characters within a formula string.
+	/// \sa charClass
+	typedef enum
+	{
+		CHAR_INVALID,     //!< Not allowed within a formula.
+		CHAR_NUM,         //!< Numerical characters 0-9.
+		CHAR_DECIM,       //!< Decimal separators , .
+		CHAR_ALPHA_U,     //!< Upper case characters A-Z.
+		CHAR_ALPHA_L,     //!< Lower case characters a-z.
+		CHAR_BRACKET_O,   //!< Opening brackets ( [ {
+		CHAR_BRACKET_C,   //!< Closing brackets ) ] }
+		CHAR_SPACE,       //!< The space character, ignored.
+		CHAR_CLASS_COUNT  //!< Number of character classes.
+	} CharClass;
+
+	/// Lookup table of the CharClass for each possible character value.
+	/// It is initialized at compile time and never modified.
+	extern const unsigned char charClassTable[256];
+
+	/// Returns the class of a single character.
+	/// \param[in] c The character to classify.
+	/// \returns Its CharClass.
+	inline CharClass 
+	charClass(char c)
+	{
+		return CharClass(charClassTable[static_cast<unsigned char>(c)]);
+	}
+} // namespace cfp
+
+#endif // this file
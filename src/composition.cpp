@@ -0,0 +1,181 @@
+/*
+ * src/composition.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <algorithm>
+#include "composition.h"
+#include "symboltable.h"
+
+/// Initial number of slots of the hash table. Sufficient for formulas
+/// of up to 8 distinct elements without growing.
+#define INITIAL_SLOT_COUNT 16
+
+using namespace cfp;
+
+namespace {
+
+/// Orders carbon first, hydrogen second and all others lexically.
+/// Isotopes of carbon and hydrogen are kept with their elements.
+/// \sa ORDER_HILL
+struct HillLess
+{
+	static int 
+	priority(SymbolId id)
+	{
+		if (id == 6) return 0; // C
+		if (id == 1) return 1; // H
+		return 2;
+	}
+
+	bool 
+	operator()(const CompactElement& a, const CompactElement& b) const
+	{
+		int pa = priority(a.symbolId());
+		int pb = priority(b.symbolId());
+		if (pa != pb) return pa < pb;
+		return a < b;
+	}
+};
+
+} // namespace
+
+Composition::Composition()
+	: mElements(),
+	  mSlots(),
+	  mGeneration(1),
+	  mAdded(0)
+{
+}
+
+void 
+Composition::clear(void)
+{
+	mElements.clear();
+	mAdded = 0;
+	mGeneration++;
+	if (mGeneration == 0) // wrapped around, invalidate explicitly
+	{
+		for (size_t i = 0; i < mSlots.size(); i++) {
+			mSlots[i].generation = 0;
+		}
+		mGeneration = 1;
+	}
+}
+
+size_t 
+Composition::hash(SymbolId symbol, int nucleons) const
+{
+	unsigned int h = symbol * 0x9E3779B1u ^ (unsigned int)nucleons * 0x85EBCA77u;
+	return (h ^ (h >> 16)) & (mSlots.size() - 1);
+}
+
+void 
+Composition::add(SymbolId symbol, int nucleons, double coefficient)
+{
+	CFP_COUNT(mAdded++);
+	if (mSlots.empty()) grow();
+	size_t mask = mSlots.size() - 1;
+	for (size_t i = hash(symbol, nucleons); ; i = (i + 1) & mask)
+	{
+		Slot& slot = mSlots[i];
+		if (slot.generation != mGeneration)
+		{
+			slot.generation = mGeneration;
+			slot.index = (unsigned int)mElements.size();
+			mElements.push_back(CompactElement(symbol, nucleons, coefficient));
+			// keep the load factor below 1/2
+			if (mElements.size() * 2 > mSlots.size()) grow();
+			return;
+		}
+		CompactElement& e = mElements[slot.index];
+		if (e.symbolId() == symbol && e.nucleons() == nucleons)
+		{
+			e.setCoefficient(e.coefficient() + coefficient);
+			return;
+		}
+	}
+}
+
+void 
+Composition::grow(void)
+{
+	if (mSlots.empty()) mSlots.resize(INITIAL_SLOT_COUNT);
+	else                mSlots.assign(mSlots.size() * 2, Slot());
+	mGeneration = 1;
+	size_t mask = mSlots.size() - 1;
+	for (size_t k = 0; k < mElements.size(); k++)
+	{
+		const CompactElement& e = mElements[k];
+		size_t i = hash(e.symbolId(), e.nucleons());
+		while (mSlots[i].generation == mGeneration) i = (i + 1) & mask;
+		mSlots[i].generation = mGeneration;
+		mSlots[i].index = (unsigned int)k;
+	}
+}
+
+size_t 
+Composition::size(void) const
+{
+	return mElements.size();
+}
+
+size_t 
+Composition::added(void) const
+{
+	return mAdded;
+}
+
+const CompactElement& 
+Composition::operator[](size_t i) const
+{
+	return mElements[i];
+}
+
+void 
+Composition::sort(ElementOrder order)
+{
+	switch (order)
+	{
+	case ORDER_LEXICAL:
+		std::sort(mElements.begin(), mElements.end());
+		break;
+	case ORDER_HILL:
+	{
+		bool carbon = false;
+		for (size_t i = 0; i < mElements.size() && !carbon; i++) {
+			carbon = (mElements[i].symbolId() == 6);
+		}
+		if (carbon) {
+			std::sort(mElements.begin(), mElements.end(), HillLess());
+		} else {
+			std::sort(mElements.begin(), mElements.end());
+		}
+		break;
+	}
+	case ORDER_APPEARANCE:
+	default:
+		break;
+	}
+}
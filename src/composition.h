@@ -0,0 +1,105 @@
+/*
+ * src/composition.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_COMPOSITION_H
+#define CFP_COMPOSITION_H
+
+#include <vector>
+#include <cfp/cfp.h>
+#include "statistics.h"
+
+namespace cfp
+{
+	/// Accumulates the coefficients of the elements of a formula.
+	/// Elements with equal symbol and nucleon number are merged, their 
+	/// coefficients are summed up. The elements are stored contiguously
+	/// in the order of their first appearance, an open addressing hash 
+	/// table keyed by symbol id and nucleon number refers to them.
+	/// Clearing takes constant time, the memory is reused for the next
+	/// formula. Memory is allocated at the first element added.
+	class Composition
+	{
+	public:
+		Composition(); //!< Creates an empty composition.
+
+		/// Removes all elements.
+		void 
+		clear(void);
+
+		/// Adds an element. If there is one with the same symbol and 
+		/// nucleon number already, the coefficient is added to it.
+		/// \param[in] symbol      Id of the symbol.
+		/// \param[in] nucleons    Nucleon number, see 
+		///                        ChemicalElementInterface::nucleons.
+		/// \param[in] coefficient Coefficient to add.
+		void 
+		add(SymbolId symbol, int nucleons, double coefficient);
+
+		/// Returns the number of distinct elements.
+		size_t 
+		size(void) const;
+
+		/// Returns the number of elements added since clear(), 
+		/// including merged ones. Always 0 without statistics, see 
+		/// CFP_NO_STATISTICS.
+		size_t 
+		added(void) const;
+
+		/// Returns an element by index.
+		const CompactElement& 
+		operator[](size_t i) const;
+
+		/// Sorts the elements. Afterwards, add() must not be used before
+		/// clear() is called.
+		/// \param[in] order The order of the elements.
+		void 
+		sort(ElementOrder order);
+
+	private:
+		/// Entry of the hash table.
+		struct Slot
+		{
+			unsigned int generation; //!< Valid, if equal to mGeneration.
+			unsigned int index;      //!< Index into mElements.
+		};
+
+		/// Returns the initial slot of an element in the hash table.
+		size_t 
+		hash(SymbolId symbol, int nucleons) const;
+
+		/// Doubles the size of the hash table and reinserts all elements.
+		/// Allocates the initial table, if there is none.
+		void 
+		grow(void);
+
+		std::vector<CompactElement> mElements;   //!< Accumulated elements.
+		std::vector<Slot>           mSlots;      //!< Hash table, size is a power of 2.
+		unsigned int                mGeneration; //!< Marks the valid slots.
+		size_t                      mAdded;      //!< Calls of add().
+	};
+} // namespace cfp
+
+#endif // this file
@@ -0,0 +1,234 @@
+/*
+ * src/compound.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <cfp/cfp.h>
+#include "symboltable.h"
+
+using namespace cfp;
+
+////// CompactCompound //////
+
+CompactCompound::CompactCompound()
+	: mData(mInline),
+	  mSize(0),
+	  mCapacity(INLINE_CAPACITY)
+{}
+
+CompactCompound::CompactCompound(const CompactCompound& c)
+	: mData(mInline),
+	  mSize(0),
+	  mCapacity(INLINE_CAPACITY)
+{
+	assign(c.begin(), c.size(), true);
+}
+
+CompactCompound::~CompactCompound()
+{
+	if (mData != mInline) delete [] mData;
+	mData = NULL;
+}
+
+CompactCompound& 
+CompactCompound::operator=(const CompactCompound& c)
+{
+	if (this != &c) {
+		assign(c.begin(), c.size(), true);
+	}
+	return *this;
+}
+
+size_t 
+CompactCompound::size(void) const
+{
+	return mSize;
+}
+
+bool 
+CompactCompound::empty(void) const
+{
+	return mSize == 0;
+}
+
+CompactCompound::const_iterator 
+CompactCompound::begin(void) const
+{
+	return mData;
+}
+
+CompactCompound::const_iterator 
+CompactCompound::end(void) const
+{
+	return mData + mSize;
+}
+
+const CompactElement& 
+CompactCompound::operator[](size_t i) const
+{
+	return mData[i];
+}
+
+CompactCompound::const_iterator 
+CompactCompound::find(SymbolId symbol, int nucleons) const
+{
+	CompactElement key(symbol, nucleons, 1.0);
+	const_iterator it = std::lower_bound(begin(), end(), key);
+	if (it != end() && 
+	    it->symbolId() == key.symbolId() && 
+	    it->nucleons() == key.nucleons()) 
+	{
+		return it;
+	}
+	return end();
+}
+
+CompactCompound::const_iterator 
+CompactCompound::find(const std::string& symbol, int nucleons) const
+{
+	// unregistered symbols are not looked up, nor registered
+	SymbolId id = SymbolTable::global().lookup(symbol.data(), symbol.length());
+	if (id == 0 && !symbol.empty()) return end();
+	return find(id, nucleons);
+}
+
+void 
+CompactCompound::clear(void)
+{
+	mSize = 0;
+}
+
+void 
+CompactCompound::reserveDiscard(size_t n)
+{
+	if (n <= mCapacity) return;
+	size_t capacity = mCapacity;
+	while (capacity < n) capacity *= 2;
+	CompactElement * data = new CompactElement[capacity];
+	if (mData != mInline) delete [] mData;
+	mData = data;
+	mCapacity = capacity;
+}
+
+void 
+CompactCompound::assign(const CompactElement * first, size_t count, bool sorted)
+{
+	mSize = 0;
+	reserveDiscard(count);
+	std::copy(first, first + count, mData);
+	mSize = count;
+	if (!sorted) std::sort(mData, mData + mSize);
+}
+
+void 
+CompactCompound::toCompound(Compound& c) const
+{
+	c.clear();
+	for (const_iterator it = begin(); it != end(); it++) {
+		c.push_back(CompoundElement(*it));
+	}
+}
+
+Compound 
+CompactCompound::toCompound(void) const
+{
+	Compound c;
+	toCompound(c);
+	return c;
+}
+
+////// BatchResult //////
+
+size_t 
+BatchResult::size(void) const
+{
+	return status.size();
+}
+
+void 
+BatchResult::clear(void)
+{
+	offsets.clear();
+	status.clear();
+	errorStart.clear();
+	errorLength.clear();
+	symbols.clear();
+	nucleons.clear();
+	coefficients.clear();
+}
+
+void 
+BatchResult::append(const BatchResult& r)
+{
+	if (r.size() == 0) return;
+	const size_t base = symbols.size();
+	if (!offsets.empty()) offsets.pop_back(); // replaced by r's first
+	for (size_t i = 0; i < r.offsets.size(); i++) {
+		offsets.push_back(base + r.offsets[i]);
+	}
+	status.insert(status.end(), r.status.begin(), r.status.end());
+	errorStart.insert(errorStart.end(), r.errorStart.begin(), r.errorStart.end());
+	errorLength.insert(errorLength.end(), r.errorLength.begin(), r.errorLength.end());
+	symbols.insert(symbols.end(), r.symbols.begin(), r.symbols.end());
+	nucleons.insert(nucleons.end(), r.nucleons.begin(), r.nucleons.end());
+	coefficients.insert(coefficients.end(), r.coefficients.begin(), r.coefficients.end());
+}
+
+////// BatchDiagnostics //////
+
+size_t 
+BatchDiagnostics::size(void) const
+{
+	return offsets.empty() ? 0 : offsets.size()-1;
+}
+
+void 
+BatchDiagnostics::clear(void)
+{
+	offsets.clear();
+	diagnostics.clear();
+}
+
+////// BatchSink //////
+
+BatchSink::~BatchSink()
+{
+}
+
+////// ::cfp:: global helper //////
+
+std::ostream& 
+std::operator<<(std::ostream& o, const CompactCompound& el)
+{
+	CompactCompound::const_iterator it = el.begin();
+	while(it != el.end())
+	{
+		o << it->toString();
+		it++;
+		if (it != el.end()) o << " ";
+	}
+	return o;
+}
@@ -26,8 +26,10 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <cfp/cfp.h>
 #include "element.h"
+#include "symboltable.h"
 
 using namespace cfp;
 
@@ -206,12 +208,40 @@ ChemicalElement::ChemicalElement(const ChemicalElementInterface& ce)
 	setNucleons(ce.nucleons());
 }
 
+ChemicalElement::ChemicalElement(ChemicalElement&& ce) noexcept
+	: ChemicalElementInterface(),
+	  mD(ce.mD)
+{
+	ce.mD = NULL;
+}
+
 ChemicalElement::~ChemicalElement()
 {
 	if (mD) delete mD;
 	mD = NULL;
 }
 
+ChemicalElement&
+ChemicalElement::operator=(const ChemicalElement& e)
+{
+	if (!mD) mD = new ChemicalElementData(*(e.mD));
+	else     *mD = *(e.mD);
+	return *this;
+}
+
+ChemicalElement&
+ChemicalElement::operator=(ChemicalElement&& e) noexcept
+{
+	swap(e);
+	return *this;
+}
+
+void 
+ChemicalElement::swap(ChemicalElement& e) throw()
+{
+	std::swap(mD, e.mD);
+}
+
 std::string 
 ChemicalElement::doSymbol() const 
 {
@@ -257,12 +287,49 @@ CompoundElement::CompoundElement(const CompoundElementInterface& ce)
 	setCoefficient(ce.coefficient());
 }
 
+CompoundElement::CompoundElement(const CompactElement& ce)
+	: CompoundElementInterface(),
+	  mD(new CompoundElementData())
+{
+	setSymbol(symbolString(ce.symbolId()));
+	setNucleons(ce.nucleons());
+	setCoefficient(ce.coefficient());
+}
+
+CompoundElement::CompoundElement(CompoundElement&& ce) noexcept
+	: CompoundElementInterface(),
+	  mD(ce.mD)
+{
+	ce.mD = NULL;
+}
+
 CompoundElement::~CompoundElement()
 {
 	if (mD) delete mD;
 	mD = NULL;
 }
 
+CompoundElement&
+CompoundElement::operator=(const CompoundElement& e)
+{
+	if (!mD) mD = new CompoundElementData(*(e.mD));
+	else     *mD = *(e.mD);
+	return *this;
+}
+
+CompoundElement&
+CompoundElement::operator=(CompoundElement&& e) noexcept
+{
+	swap(e);
+	return *this;
+}
+
+void 
+CompoundElement::swap(CompoundElement& e) throw()
+{
+	std::swap(mD, e.mD);
+}
+
 std::string 
 CompoundElement::doSymbol() const
 {
@@ -314,6 +381,13 @@ CompoundGroupElement::CompoundGroupElement(const CompoundGroupElement& cge)
 	  mD(new CompoundGroupElementData(*(cge.mD)))
 {}
 
+CompoundGroupElement::CompoundGroupElement(CompoundGroupElement&& cge) noexcept
+	: CompoundElementInterface(),
+	  mD(cge.mD)
+{
+	cge.mD = NULL;
+}
+
 CompoundGroupElement::~CompoundGroupElement()
 {
 	if (mD) delete mD;
@@ -323,17 +397,47 @@ CompoundGroupElement::~CompoundGroupElement()
 CompoundGroupElement&
 CompoundGroupElement::operator=(const CompoundGroupElement& e)
 {
-	CompoundElementInterface::operator=(e);
-	mD->isGroup = e.isGroup();
+	if (!mD) mD = new CompoundGroupElementData(*(e.mD));
+	else     *mD = *(e.mD);
+	return *this;
+}
+
+CompoundGroupElement&
+CompoundGroupElement::operator=(CompoundGroupElement&& e) noexcept
+{
+	std::swap(mD, e.mD);
 	return *this;
 }
 
+void
+CompoundGroupElement::assignSymbol(const char * str, size_t len, SymbolId id)
+{
+	mD->symbol.assign(str, len);
+	mD->symbolId = id;
+}
+
+void
+CompoundGroupElement::reset(double c, bool g)
+{
+	mD->symbol.clear();
+	mD->symbolId = 0;
+	mD->nucleons = naturalNucleonNr();
+	mD->coefficient = c;
+	mD->isGroup = g;
+}
+
 bool
 CompoundGroupElement::isGroup(void) const
 {
 	return mD->isGroup;
 }
 
+SymbolId
+CompoundGroupElement::symbolId(void) const
+{
+	return mD->symbolId;
+}
+
 std::string 
 CompoundGroupElement::doSymbol() const
 {
@@ -344,6 +448,7 @@ void
 CompoundGroupElement::doSetSymbol(const std::string& s)
 {
 	mD->symbol.assign(s);
+	mD->symbolId = cfp::symbolId(s);
 }
 
 int
@@ -370,6 +475,110 @@ CompoundGroupElement::doSetCoefficient(double c)
 	mD->coefficient = c;
 }
 
+////// CompactElement //////
+
+/// Compile time check of the size promised in the documentation.
+typedef char CompactElementSizeCheck[sizeof(CompactElement) == 16 ? 1 : -1];
+
+CompactElement::CompactElement()
+	: mSymbol(0),
+	  mNucleons(ChemicalElementInterface::naturalNucleonNr()),
+	  mCoefficient(1.0)
+{}
+
+CompactElement::CompactElement(SymbolId symbol, int nucleons, double coefficient)
+	: mSymbol(symbol),
+	  mNucleons(ChemicalElementInterface::naturalNucleonNr()),
+	  mCoefficient(coefficient)
+{
+	setNucleons(nucleons);
+}
+
+CompactElement::CompactElement(const CompoundElementInterface& e)
+	: mSymbol(cfp::symbolId(e.symbol())),
+	  mNucleons(e.nucleons()),
+	  mCoefficient(e.coefficient())
+{}
+
+std::string 
+CompactElement::symbol(void) const
+{
+	return symbolString(mSymbol);
+}
+
+void
+CompactElement::setSymbol(const std::string& s)
+{
+	mSymbol = cfp::symbolId(s);
+}
+
+SymbolId
+CompactElement::symbolId(void) const
+{
+	return mSymbol;
+}
+
+void
+CompactElement::setSymbolId(SymbolId id)
+{
+	mSymbol = id;
+}
+
+int
+CompactElement::nucleons(void) const
+{
+	return mNucleons;
+}
+
+void
+CompactElement::setNucleons(int i)
+{
+	if (i <= 0) i = ChemicalElementInterface::naturalNucleonNr();
+	mNucleons = i;
+}
+
+bool
+CompactElement::isIsotope(void) const
+{
+	return mNucleons != ChemicalElementInterface::naturalNucleonNr();
+}
+
+double
+CompactElement::coefficient(void) const
+{
+	return mCoefficient;
+}
+
+void
+CompactElement::setCoefficient(double c)
+{
+	mCoefficient = c;
+}
+
+std::string
+CompactElement::toString(void) const
+{
+	return CompoundElement(*this).toString();
+}
+
+std::string
+CompactElement::toMarkup(void) const
+{
+	return CompoundElement(*this).toMarkup();
+}
+
+bool
+CompactElement::operator<(const CompactElement& e) const
+{
+	if (mSymbol == e.mSymbol) {
+		return mNucleons < e.mNucleons;
+	}
+	if (isPeriodicSymbolId(mSymbol) && isPeriodicSymbolId(e.mSymbol)) {
+		return periodicRankTable[mSymbol] < periodicRankTable[e.mSymbol];
+	}
+	return symbolString(mSymbol) < symbolString(e.mSymbol);
+}
+
 ////// ::cfp:: global helper //////
 
 std::string 
@@ -401,6 +610,13 @@ std::operator<<(std::ostream& o, const ChemicalElementInterface& e)
 	return o;
 }
 
+std::ostream& 
+std::operator<<(std::ostream& o, const CompactElement& e)
+{
+	o << e.toString();
+	return o;
+}
+
 std::ostream& 
 std::operator<<(std::ostream& o, const Compound& el)
 {
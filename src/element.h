@@ -60,12 +60,15 @@ namespace cfp
 		/// Default constructor with initialization.
 		CompoundGroupElementData()
 			: CompoundElementData(), 
-			  isGroup(false)
+			  isGroup(false),
+			  symbolId(0)
 		{}
 
 		/// Decides if the coefficient is associated to a group rather
 		/// than to a single element.
 		bool isGroup;
+
+		SymbolId symbolId; //!< Id of the symbol, see cfp::symbolId.
 	};
 
 	/// Additional to the properties of a cfp::CompoundElement, this
@@ -87,6 +90,10 @@ namespace cfp
 		/// Copy constructor.
 		CompoundGroupElement(const CompoundGroupElement& cge);
 
+		/// Move constructor. \e cge may only be assigned to or 
+		/// destroyed afterwards.
+		CompoundGroupElement(CompoundGroupElement&& cge) noexcept;
+
 		~CompoundGroupElement(); //!< Destructor.
 
 		/// Identifies an CompoundElement as group descriptor.
@@ -95,9 +102,33 @@ namespace cfp
 		bool 
 		isGroup(void) const;
 
+		/// Returns the id of the symbol.
+		/// Same as cfp::symbolId(symbol()) without copying the symbol.
+		SymbolId 
+		symbolId(void) const;
+
 		/// Copy operator all elements of this kind.
+		/// Copies into the storage of this element.
 		CompoundGroupElement& 
 		operator=(const CompoundGroupElement& e);
+
+		/// Move assignment. Exchanges the data with \e e.
+		CompoundGroupElement& 
+		operator=(CompoundGroupElement&& e) noexcept;
+
+		/// Sets the symbol from a span of characters and its already
+		/// looked up id without creating a temporary string.
+		/// \param[in] str Characters of the symbol.
+		/// \param[in] len Number of characters in \e str.
+		/// \param[in] id  Id of the symbol, see symbolId().
+		void 
+		assignSymbol(const char * str, size_t len, SymbolId id);
+
+		/// Resets all properties as if newly constructed. 
+		/// Keeps the allocated memory.
+		/// \sa CompoundGroupElement(double, bool)
+		void 
+		reset(double coefficient = 1.0, bool isGroup = false);
 	private:
 		/// Specific implementation of ChemicalElementInterface::doSymbol.
 		virtual std::string 
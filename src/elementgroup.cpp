@@ -24,108 +24,389 @@
  * Ingo Bressler (libcfp at ingobressler.net)
  */
 
-#include <set>
 #include "parserstate.h"
 
 using namespace cfp;
 
-std::vector<ElementGroup::ParseFunc> 
-	ElementGroup::mAddTokenFunctions;
+/// Marks ElementGroup::mBackItem as unset.
+#define NO_ITEM ((size_t)-1)
+
+// indexed by Token::Type
+const ElementGroup::ParseFunc 
+	ElementGroup::mAddTokenFunctions[Token::TYPE_NONE+1] = {
+		&ElementGroup::addTokenSymbol,
+		&ElementGroup::addTokenGroup,
+		&ElementGroup::addTokenInt,
+		&ElementGroup::addTokenFloat,
+		&ElementGroup::addTokenNone
+	};
 
 ElementGroup::ElementGroup()
-	: mLastElementProperty(NO_PROPERTY)
+	: mPool(NULL),
+	  mAllocatedNodes(0),
+	  mTopSize(0),
+	  mListValid(false),
+	  mCompactValid(false),
+	  mLexical(false),
+	  mComposition(),
+	  mEmpiricalOnly(false),
+	  mCount(0),
+	  mBack(),
+	  mPending(NULL),
+	  mBackBegin(0),
+	  mOpenBegin(0),
+	  mBackItem(NO_ITEM),
+	  mNested(false),
+	  mLastElementProperty(NO_PROPERTY)
 {
-	if (mAddTokenFunctions.size() != Token::TYPE_NONE+1)
-	{
-		mAddTokenFunctions.clear();
-		mAddTokenFunctions.push_back(&ElementGroup::addTokenSymbol);
-		mAddTokenFunctions.push_back(&ElementGroup::addTokenGroup);
-		mAddTokenFunctions.push_back(&ElementGroup::addTokenInt);
-		mAddTokenFunctions.push_back(&ElementGroup::addTokenFloat);
-		mAddTokenFunctions.push_back(&ElementGroup::addTokenNone);
-	}
 }
 
 size_t
 ElementGroup::size() const 
 {
+	if (mEmpiricalOnly) return mCount;
 	return mF.size();
 }
 
 bool 
 ElementGroup::empty() const
 {
+	if (mEmpiricalOnly) return mCount == 0;
 	return mF.empty();
 }
 
 void 
 ElementGroup::clear()
 {
-	mF.clear();
-	mList.clear();
+	if (mPool) mPool->splice(mPool->end(), mF);
+	else       mF.clear();
+	mSpareList.splice(mSpareList.end(), mList);
+	mListValid = false;
+	mCompact.clear();
+	mCompactValid = false;
+	mComposition.clear();
+	mCount = 0;
+	mTopSize = 0;
+	mBackItem = NO_ITEM;
+	mLastElementProperty = NO_PROPERTY;
+}
+
+void 
+ElementGroup::assignComposition(const std::vector<CompactElement>& elements)
+{
+	clear();
+	mEmpiricalOnly = true;
+	for (size_t i = 0; i < elements.size(); i++) {
+		const CompactElement& e = elements[i];
+		mComposition.add(e.symbolId(), e.nucleons(), e.coefficient());
+	}
+}
+
+size_t 
+ElementGroup::allocatedNodes(void) const
+{
+	return mAllocatedNodes;
+}
+
+void 
+ElementGroup::setNodePool(NodePool * pool)
+{
+	mPool = pool;
+}
+
+void 
+ElementGroup::setPendingStack(PendingStack * stack)
+{
+	mPending = stack;
+}
+
+void 
+ElementGroup::setEmpiricalOnly(bool empiricalOnly)
+{
+	mEmpiricalOnly = empiricalOnly;
+}
+
+void 
+ElementGroup::setNested(bool nested)
+{
+	mNested = nested;
 }
 
 CompoundGroupElement&
 ElementGroup::back()
 {
+	if (mEmpiricalOnly) return mBack;
 	return mF.back();
 }
 
 const CompoundGroupElement&
 ElementGroup::back() const
 {
+	if (mEmpiricalOnly) return mBack;
 	return mF.back();
 }
 
 void 
-ElementGroup::add(const CompoundGroupElement& e)
+ElementGroup::addElement(bool isGroup)
+{
+	if (mEmpiricalOnly) {
+		// reuses the last element
+		commitBack();
+		mBack.reset(1.0, isGroup);
+		mCount++;
+		return;
+	}
+	appendNode(isGroup);
+}
+
+ElementGroup::GrammarState 
+ElementGroup::grammarState(void) const
+{
+	GrammarState s;
+	s.empty = empty();
+	s.backSymbol = !s.empty && back().symbolId() != 0;
+	s.backGroup = !s.empty && back().isGroup();
+	s.property = (unsigned char)mLastElementProperty;
+	return s;
+}
+
+void 
+ElementGroup::restoreGrammar(const GrammarState& state)
+{
+	mLastElementProperty = LastElementProperty(state.property);
+}
+
+size_t 
+ElementGroup::topSize(void) const
 {
-	mF.insert(mF.end(), e);
+	return mTopSize;
+}
+
+ElementGroup::fiterator 
+ElementGroup::topNode(size_t index)
+{
+	typedef forest::child_iterator citerator;
+	if (index <= mTopSize / 2) {
+		citerator i(mF.begin());
+		for (; index > 0; index--) ++i;
+		return i.base();
+	}
+	citerator i(mF.end());
+	for (index = mTopSize - index; index > 0; index--) --i;
+	return i.base();
 }
 
 void 
-ElementGroup::addGroup(const ElementGroup& eg)
+ElementGroup::cutTail(size_t first, ElementGroup& rest)
 {
-	fiterator i = adobe::trailing_of(
-	                mF.insert(mF.end(), CompoundGroupElement(1.0, true)));
-	mF.insert(i, adobe::child_begin(eg.mF.end()),
-	              adobe::child_end(eg.mF.end()));
+	if (first >= mTopSize) return;
+	typedef forest::child_iterator citerator;
+	rest.mF.splice(rest.mF.end(), mF, citerator(topNode(first)), 
+	               citerator(mF.end()));
+	rest.mTopSize += mTopSize - first;
+	mTopSize = first;
+}
+
+void 
+ElementGroup::appendTail(ElementGroup& rest, size_t first)
+{
+	typedef forest::child_iterator citerator;
+	if (first < rest.mTopSize) {
+		mF.splice(mF.end(), rest.mF, citerator(rest.topNode(first)), 
+		          citerator(rest.mF.end()));
+		mTopSize += rest.mTopSize - first;
+	}
+	rest.clear();
+}
+
+ElementGroup::fiterator 
+ElementGroup::appendNode(bool isGroup)
+{
+	mTopSize++;
+	if (!mPool || mPool->empty()) {
+		CFP_COUNT(mAllocatedNodes++);
+		return mF.insert(mF.end(), CompoundGroupElement(1.0, isGroup));
+	}
+	// the children of the first node are moved to the top level of
+	// the pool in constant time, the node is moved alone then
+	fiterator first = mPool->begin();
+	if (adobe::has_children(first)) {
+		mPool->splice(mPool->end(), *mPool, 
+		              adobe::child_begin(first), adobe::child_end(first));
+	}
+	fiterator node = mF.splice(mF.end(), *mPool, first);
+	node->reset(1.0, isGroup);
+	return node;
+}
+
+void 
+ElementGroup::openSubgroup(void)
+{
+	if (!mEmpiricalOnly) return;
+	// mBack may still change, its item precedes the subgroup
+	PendingItem item;
+	item.kind = PendingItem::SKIP;
+	mOpenBegin = mPending->size();
+	if (mNested) {
+		mBackItem = mPending->size();
+		mPending->push_back(item);
+	}
+	item.kind = PendingItem::GROUP_BEGIN;
+	mPending->push_back(item);
+}
+
+void 
+ElementGroup::commitBack(void)
+{
+	if (mCount == 0) return;
+	PendingStack& pending = *mPending;
+	if (mBack.isGroup()) {
+		// its coefficient is final now
+		pending[mBackBegin].element = 
+			CompactElement(0, 0, mBack.coefficient());
+	} else if (mNested) {
+		// the coefficients of the enclosing groups are not known yet
+		PendingItem item;
+		item.element = CompactElement(mBack.symbolId(), mBack.nucleons(), 
+		                              mBack.coefficient());
+		item.kind = PendingItem::ELEMENT;
+		if (mBackItem == NO_ITEM) pending.push_back(item);
+		else                      pending[mBackItem] = item;
+		mBackItem = NO_ITEM;
+		return;
+	} else {
+		mComposition.add(mBack.symbolId(), mBack.nucleons(), 
+		                 mBack.coefficient());
+		return;
+	}
+	if (mNested) return;
+	// the same products and order as accumulateTree(), up to the 
+	// GROUP_END of mBack
+	std::vector<double>& coef_stack = mCoefStack;
+	coef_stack.clear();
+	coef_stack.push_back(1.0);
+	size_t i = mBackBegin;
+	do {
+		const PendingItem& p = pending[i++];
+		const CompactElement& e = p.element;
+		if (p.kind == PendingItem::GROUP_BEGIN) {
+			coef_stack.push_back(coef_stack.back() * e.coefficient());
+		} else if (p.kind == PendingItem::GROUP_END) {
+			coef_stack.pop_back();
+		} else if (p.kind == PendingItem::ELEMENT) {
+			mComposition.add(e.symbolId(), e.nucleons(), 
+			                 e.coefficient() * coef_stack.back());
+		}
+	} while (coef_stack.size() > 1);
+}
+
+void 
+ElementGroup::dropSubgroup(void)
+{
+	if (!mEmpiricalOnly) return;
+	mPending->resize(mOpenBegin);
+	mBackItem = NO_ITEM;
+}
+
+void 
+ElementGroup::addGroup(ElementGroup& eg)
+{
+	if (mEmpiricalOnly) {
+		// the items of eg follow the ones reserved by openSubgroup()
+		eg.commitBack();
+		PendingItem item;
+		item.kind = PendingItem::GROUP_END;
+		mPending->push_back(item);
+		addElement(true);
+		mBackItem = NO_ITEM;
+		mBackBegin = mNested ? mOpenBegin + 1 : mOpenBegin;
+		eg.clear();
+		return;
+	}
+	fiterator i = adobe::trailing_of(appendNode(true));
+	// relinks the nodes, no copies
+	mF.splice(i, eg.mF);
 }
 
 const Compound&
 ElementGroup::flatList(void) const
 {
+	if (!mListValid) 
+	{
+		// reuses the elements of the previous list
+		mSpareList.splice(mSpareList.end(), mList);
+		for (size_t i = 0; i < mComposition.size(); i++) 
+		{
+			const CompactElement& e = mComposition[i];
+			if (mSpareList.empty()) {
+				mList.push_back(CompoundElement());
+			} else {
+				mList.splice(mList.end(), mSpareList, mSpareList.begin());
+			}
+			mList.back().setSymbol(symbolString(e.symbolId()));
+			mList.back().setNucleons(e.nucleons());
+			mList.back().setCoefficient(e.coefficient());
+		}
+		mListValid = true;
+	}
 	return mList;
 }
 
-// set of elements without group feature (for outside use)
-typedef std::set<CompoundElement> Set;
+const Composition&
+ElementGroup::composition(void) const
+{
+	return mComposition;
+}
 
-void 
-addToSet(Set& s, CompoundElement& e)
+const CompactCompound&
+ElementGroup::compactList(void) const
 {
-	Set::iterator it = s.find(e);
-	if (it != s.end()) 
+	if (!mCompactValid) 
 	{
-		double coef = it->coefficient();
-		e.setCoefficient(coef + e.coefficient());
-		// we must not modify the element in the set
-		s.erase(it);
-	} 
-	bool success = s.insert(e).second;
-	if (!success) {
-		// what to do ? at least tell about it.
-		std::cerr << "Could not insert into std::map!" << std::endl;
+		if (mComposition.size() > 0) {
+			mCompact.assign(&mComposition[0], mComposition.size(), mLexical);
+		} else {
+			mCompact.clear();
+		}
+		mCompactValid = true;
 	}
+	return mCompact;
 }
 
 void 
-ElementGroup::flatten(void)
+ElementGroup::flatten(ElementOrder order, Parser::Statistics * stats)
+{
+	mListValid = false;
+	mCompactValid = false;
+	size_t nodes = 0;
+	if (mEmpiricalOnly) {
+		// all but the last element are accumulated already
+		commitBack();
+		mCount = 0;
+	} else {
+		nodes = accumulateTree();
+	}
+#ifndef CFP_NO_STATISTICS
+	if (stats) {
+		stats->treeNodes += nodes;
+		stats->mergedElements += mComposition.added() - mComposition.size();
+	}
+#else
+	(void)nodes;
+	(void)stats;
+#endif
+	mComposition.sort(order);
+	mLexical = (order == ORDER_LEXICAL);
+}
+
+size_t 
+ElementGroup::accumulateTree(void)
 {
-	std::vector<double> coef_stack;
-	Set set;
+	std::vector<double>& coef_stack = mCoefStack;
+	size_t nodes = 0;
 
-	mList.clear();
+	coef_stack.clear();
+	mComposition.clear();
 	diterator f = diterator(mF.begin());
 	diterator l = diterator(mF.end());
 	while(f != l) 
@@ -139,6 +420,7 @@ ElementGroup::flatten(void)
 			{
 				coef_stack.pop_back();
 			} else {
+				nodes++;
 				double prev_coef = 1.0;
 				if (!coef_stack.empty()) {
 					prev_coef = coef_stack.back();
@@ -151,14 +433,14 @@ ElementGroup::flatten(void)
 			if (!coef_stack.empty()) {
 				coef = coef_stack.back();
 			}
-			CompoundElement e(*f);
-			e.setCoefficient( e.coefficient() * coef );
-			addToSet(set, e);
+			mComposition.add(f->symbolId(), f->nucleons(), 
+			                 f->coefficient() * coef);
 			f = adobe::trailing_of(f);
+			nodes++;
 		}
 		f++;
 	}
-	copy(set.begin(), set.end(), back_inserter(mList));
+	return nodes;
 }
 
 std::ostream& 
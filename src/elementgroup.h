@@ -33,6 +33,7 @@
 
 #include <cfp/cfp.h>
 #include "element.h"
+#include "composition.h"
 
 namespace cfp {
 	class ElementGroup;
@@ -64,6 +65,17 @@ namespace cfp
 	/// flat empirical element list ( flatten() ).
 	/// Alternative result types are possible too, of course, but not yet
 	/// implemented.
+	///
+	/// In empirical-only mode, the tree is not built. Only the last 
+	/// element (or group) added is kept, the previous ones are 
+	/// accumulated directly into the flat empirical result. Elements of
+	/// groups wait on a PendingStack shared by all groups of a formula 
+	/// until the top level group knows the coefficients of all 
+	/// enclosing groups. Each item is written once, in the order of 
+	/// accumulateTree(), and read once. They are accumulated with the
+	/// same products, so both modes give bit-identical results. The 
+	/// parsing decisions are the same, too.
+	/// \sa setEmpiricalOnly
 	class ElementGroup
 	{
 	private:
@@ -82,15 +94,62 @@ namespace cfp
 		/// \see ElementGroup(), parse_details.cpp
 		typedef void (ElementGroup::*ParseFunc) (ParserState& s);
 	public:
+		/// Spare tree nodes, shared by the groups of a ParserState.
+		/// The nodes of cleared groups are moved there and reused by
+		/// subsequent formulas, including the data of their elements. 
+		/// Thus, parsing allocates no memory once the pool is as large
+		/// as the largest formula.
+		typedef adobe::forest<CompoundGroupElement> NodePool;
+
+		/// Element or bracket of a group in empirical-only mode. 
+		/// A group is stored as GROUP_BEGIN with its coefficient, the
+		/// items of its content and GROUP_END, as accumulateTree() 
+		/// visits it. SKIP marks an unused reserved item.
+		struct PendingItem
+		{
+			typedef enum { ELEMENT, GROUP_BEGIN, GROUP_END, SKIP } Kind;
+			CompactElement element; //!< The element or the coefficient.
+			unsigned char  kind;    //!< One of Kind.
+		};
+
+		/// Items of the groups of a formula in empirical-only mode, 
+		/// shared by the groups of a ParserState.
+		typedef std::vector<PendingItem> PendingStack;
+
 		ElementGroup(); //!< Creates an empty group.
 
 		/// Returns the number of elements including group descriptors.
+		/// In empirical-only mode, the number of elements and groups
+		/// added directly to this group.
 		size_t 
 		size() const;
 
 		/// Clears internal data structures.
 		void 
 		clear();
+
+		/// Selects the pool for the nodes of this group.
+		/// Without pool, nodes are allocated and freed individually.
+		/// \param[in] pool The pool to use, NULL for none.
+		void 
+		setNodePool(NodePool * pool);
+
+		/// Selects the stack for the items of groups in empirical-only 
+		/// mode. Required in that mode if groups are added.
+		/// \param[in] stack The stack to use.
+		void 
+		setPendingStack(PendingStack * stack);
+
+		/// Selects the empirical-only mode for the elements added next.
+		/// Has to be set before adding the first element.
+		void 
+		setEmpiricalOnly(bool empiricalOnly);
+
+		/// Tells if this group is enclosed by another one, so the 
+		/// coefficients of its elements are not final in empirical-only
+		/// mode. False by default, for the top level group.
+		void 
+		setNested(bool nested);
 		
 		/// Adds the current Token data to this element group.
 		/// Eventually, creates a new CompoundElement from it or adds its data
@@ -98,21 +157,108 @@ namespace cfp
 		void 
 		addToken(ParserState& s);
 
+		/// Announces a subgroup which is added by addSubgroup() next. 
+		/// In empirical-only mode, reserves the items of the last 
+		/// element and of the subgroup before the items of its content.
+		void 
+		openSubgroup(void);
+
 		/// Adds another element group.
 		/// Some parsing related decisions are made here regarding
 		/// nucleon numbers, respectively isotopes which are distinct
 		/// element groups formally.
+		/// The elements of \e subGrp are moved, it may be empty afterwards.
+		/// Errors are reported by ParserState::fail.
 		/// \sa addGroup
 		void 
-		addSubgroup(const ElementGroup& subGrp, size_t strIdx);
+		addSubgroup(ParserState& s, ElementGroup& subGrp, size_t strIdx);
 
 		/// Returns the flat empirical formula representation.
+		/// It is created at the first call after flatten().
 		const Compound& 
 		flatList(void) const;
 
-		/// Converts the tree structure into a flat element list.
+		/// Returns the accumulated elements in the order chosen at 
+		/// flatten().
+		const Composition& 
+		composition(void) const;
+
+		/// Returns the flat empirical formula representation as 
+		/// contiguous array in lexical order.
+		/// It is created at the first call after flatten().
+		const CompactCompound& 
+		compactList(void) const;
+
+		/// Replaces the content by accumulated elements, as if they had
+		/// been parsed in empirical-only mode. flatten() has to be 
+		/// called afterwards.
+		/// \param[in] elements The elements.
+		void 
+		assignComposition(const std::vector<CompactElement>& elements);
+
+		/// Accumulates the elements of the tree into a flat empirical 
+		/// representation, see flatList() and compactList().
+		/// In empirical-only mode, finishes the accumulated elements.
+		/// \param[in] order The order of the elements in the list.
+		/// \param[in] stats Counters of the nodes and merged elements,
+		///                  may be NULL.
 		void 
-		flatten(void);
+		flatten(ElementOrder order = ORDER_LEXICAL, 
+		        Parser::Statistics * stats = NULL);
+
+		/// Returns the number of tree nodes this group allocated, 
+		/// instead of taking them from the pool, since its creation.
+		size_t 
+		allocatedNodes(void) const;
+
+		/// State of the grammar between two tokens. Equal states 
+		/// translate the following tokens the same way.
+		/// \sa grammarState
+		struct GrammarState
+		{
+			bool          empty;      //!< No element added yet.
+			bool          backSymbol; //!< Last element has a symbol.
+			bool          backGroup;  //!< Last element is a group.
+			unsigned char property;   //!< Property set last.
+
+			/// Tells if both states translate tokens the same way.
+			bool 
+			operator==(const GrammarState& s) const
+			{
+				return empty == s.empty && backSymbol == s.backSymbol && 
+				       backGroup == s.backGroup && property == s.property;
+			}
+		};
+
+		/// Returns the current state of the grammar of this group.
+		GrammarState 
+		grammarState(void) const;
+
+		/// Restores the property set last of a previous grammarState(),
+		/// after the elements were changed by cutTail() or appendTail().
+		void 
+		restoreGrammar(const GrammarState& state);
+
+		/// Returns the number of top level elements and groups of the 
+		/// tree, not counting the elements of subgroups.
+		size_t 
+		topSize(void) const;
+
+		/// Moves the top level elements and groups from index \e first
+		/// on to the end of \e rest, in constant time per element.
+		/// The previous elements are kept.
+		/// \param[in]     first Index of the first element to move.
+		/// \param[in,out] rest  An empty group, in tree mode.
+		void 
+		cutTail(size_t first, ElementGroup& rest);
+
+		/// Moves the top level elements and groups of \e rest from 
+		/// index \e first on to the end of this group. The others 
+		/// return to the pool, \e rest is empty afterwards.
+		/// \param[in,out] rest  Elements cut by cutTail().
+		/// \param[in]     first Index of the first element to move.
+		void 
+		appendTail(ElementGroup& rest, size_t first);
 
 		friend std::ostream& 
 		std::operator<<(std::ostream& o, const ElementGroup& eg);
@@ -126,8 +272,22 @@ namespace cfp
 		const CompoundGroupElement& 
 		back() const;  //!< Returns the last element added.
 
+		/// Adds a new empty element to the tree.
+		/// \param[in] isGroup True, if it is a group descriptor.
 		void 
-		add(const CompoundGroupElement& e); //!< Adds a new element to the tree.
+		addElement(bool isGroup = false);
+
+		/// Returns the top level element at \e index, walking from 
+		/// the nearer end of the tree.
+		fiterator 
+		topNode(size_t index);
+
+		/// Appends a new node to the tree, taken from the pool if
+		/// possible.
+		/// \param[in] isGroup True, if it is a group descriptor.
+		/// \returns The leading edge of the new node.
+		fiterator 
+		appendNode(bool isGroup);
 
 		/// Adds another element group. It gets hierarchical here.
 		/// Final layout:
@@ -139,7 +299,25 @@ namespace cfp
 		/// <e*[0-9]+> are regular elements
 		/// <g> is a CompoundGroupElement with isGroup==true
 		/// \endcode
-		void addGroup(const ElementGroup& eg);
+		/// The elements are spliced from \e eg in constant time, 
+		/// \e eg is empty afterwards.
+		/// In empirical-only mode, the items of \e eg on the 
+		/// PendingStack become the contents of the last element.
+		void addGroup(ElementGroup& eg);
+
+		/// Discards the items of a subgroup which is not added as group
+		/// in empirical-only mode, including the ones reserved by 
+		/// openSubgroup().
+		void dropSubgroup(void);
+
+		/// Accumulates the last element in empirical-only mode, or 
+		/// writes it to the PendingStack in a nested group.
+		void commitBack(void);
+
+		/// Accumulates all elements of the tree, multiplied by the 
+		/// coefficients of their groups.
+		/// \returns The number of nodes of the tree.
+		size_t accumulateTree(void);
 
 		void addTokenSymbol(ParserState& s);//!< Handles a symbol token.
 		void addTokenInt(ParserState& s);   //!< Handles a natural number token.
@@ -150,12 +328,70 @@ namespace cfp
 		/// Tree data structure containing all CompoundGroupElement objects.
 		forest   mF;
 
-		/// Flat empirical element list.
-		Compound mList;
+		/// Flat empirical element list, created on demand.
+		mutable Compound mList;
+
+		/// Elements of previous flat lists, reused for mList.
+		mutable Compound mSpareList;
+
+		/// Spare tree nodes, may be NULL.
+		NodePool * mPool;
+
+		/// Number of nodes allocated, see allocatedNodes().
+		size_t mAllocatedNodes;
+
+		/// Number of top level nodes, see topSize().
+		size_t mTopSize;
+
+		/// Coefficients of the enclosing groups in accumulateTree(),
+		/// kept to reuse its memory.
+		std::vector<double> mCoefStack;
+
+		/// True, if mList is up to date.
+		mutable bool mListValid;
+
+		/// Flat empirical element array, created on demand.
+		mutable CompactCompound mCompact;
+
+		/// True, if mCompact is up to date.
+		mutable bool mCompactValid;
+
+		/// True, if mComposition is in lexical order.
+		bool mLexical;
+
+		/// Accumulator of the elements for flatten(), reused for each
+		/// formula. In empirical-only mode, it contains all elements 
+		/// added except the last one.
+		Composition mComposition;
+
+		/// True, if no tree is built.
+		bool mEmpiricalOnly;
+
+		/// Number of elements and groups added in empirical-only mode.
+		size_t mCount;
+
+		/// Last element or group added in empirical-only mode.
+		CompoundGroupElement mBack;
+
+		/// Items of the groups in empirical-only mode, may be NULL.
+		PendingStack * mPending;
+
+		/// Index of the GROUP_BEGIN item of mBack, if it is a group.
+		size_t mBackBegin;
+
+		/// Index of the first item reserved by openSubgroup().
+		size_t mOpenBegin;
+
+		/// Index of the item reserved for mBack by openSubgroup(), 
+		/// NO_ITEM if mBack is committed to the end of mPending.
+		size_t mBackItem;
+
+		/// True, if enclosed by another group, see setNested().
+		bool mNested;
 
 		/// Array of Functions to handle different Tokens based on
-		/// their type.
-		static std::vector<ParseFunc> mAddTokenFunctions;
+		/// their type. Initialized at compile time.
+		static const ParseFunc mAddTokenFunctions[];
 
 		/// Property of an element which was set last during
 		/// formula parsing.
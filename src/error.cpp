@@ -24,21 +24,96 @@
  * Ingo Bressler (libcfp at ingobressler.net)
  */
 
+#include <cstdlib>
 #include <cfp/error.h>
 
 using namespace cfp;
 
+namespace {
+
+/// Descriptions of the errors, indexed by ErrorCode.
+const char * const errorMessages[] = {
+	"",
+	"Parse error !",
+	"Invalid Character !",
+	"Symbols must not begin with lower case characters !",
+	"Decimal operator only between numerical characters allowed !",
+	"Maximum nesting level reached !",
+	"Expression must not begin with floating point value !",
+	"Nucleon number specified without preceding Element symbol !",
+	"Encountered closing bracket without preceding opening bracket !",
+	"Missing closing bracket !",
+	"Unknown element symbol !",
+	"Unable to read the formula file !"
+};
+
+} // namespace
+
+const char *
+cfp::errorMessage(ErrorCode code)
+{
+	if (size_t(code) >= sizeof(errorMessages)/sizeof(errorMessages[0])) {
+		return errorMessages[ERROR_GENERIC];
+	}
+	return errorMessages[code];
+}
+
+void
+cfp::throwError(const Status& s)
+{
+	if (s.code == ERROR_NONE) return;
+#ifdef CFP_NO_EXCEPTIONS
+	std::abort();
+#else
+	switch (s.code)
+	{
+		case ERROR_INVALID_CHAR:
+			throw ErrorInvalidChar(s.start, s.length);
+		case ERROR_SYM_BEG_LOW_CHAR:
+			throw ErrorSymBegLowChar(s.start, s.length);
+		case ERROR_DECIM_BETW_INT:
+			throw ErrorDecimBetwInt(s.start, s.length);
+		case ERROR_MAX_NESTING:
+			throw ErrorMaxNesting(s.start, s.length);
+		case ERROR_START_WITH_COEF:
+			throw ErrorStartWithCoef(s.start, s.length);
+		case ERROR_LONE_NUCLEON_NUM:
+			throw ErrorLoneNucleonNum(s.start, s.length);
+		case ERROR_LONE_CLOSING_BRACKET:
+			throw ErrorLoneClosingBracket(s.start, s.length);
+		case ERROR_MISSING_CLOSING_BRACKET:
+			throw ErrorMissingClosingBracket(s.start, s.length);
+		case ERROR_UNKNOWN_SYMBOL:
+			throw ErrorUnknownSymbol(s.start, s.length);
+		case ERROR_FILE_ACCESS:
+			throw ErrorFileAccess();
+		default:
+			throw Error(s.start, s.length);
+	}
+#endif
+}
+
 Error::Error(const std::string& msg, size_t start, size_t length)
 	: msg_m(msg),
 	  start_m(start), 
-	  length_m(length)
+	  length_m(length),
+	  code_m(ERROR_GENERIC)
+{
+}
+
+Error::Error(ErrorCode code, const std::string& msg, size_t start, size_t length)
+	: msg_m(msg),
+	  start_m(start), 
+	  length_m(length),
+	  code_m(code)
 {
 }
 
 Error::Error(size_t start, size_t length)
 	: msg_m(),
 	  start_m(start), 
-	  length_m(length)
+	  length_m(length),
+	  code_m(ERROR_GENERIC)
 {
 }
 
@@ -77,3 +152,9 @@ Error::whatStr(size_t& start, size_t& length) const throw()
 	return whatStr();
 }
 
+ErrorCode
+Error::code() const throw()
+{
+	return code_m;
+}
+
@@ -0,0 +1,217 @@
+/*
+ * src/formulacache.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <cstring>
+#include "formulacache.h"
+
+/// Maximum number of shards of a FormulaCache.
+#define CACHE_SHARD_COUNT 16
+
+using namespace cfp;
+
+namespace {
+
+/// Mixes the bits of a hash value (finalizer of MurmurHash3).
+inline uint64_t 
+mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/// Returns the number of shards for a capacity, a power of 2.
+size_t 
+shardCount(size_t capacity)
+{
+	size_t n = 1;
+	while (n < CACHE_SHARD_COUNT && n * 2 <= capacity) n *= 2;
+	return n;
+}
+
+} // namespace
+
+////// FormulaCacheData //////
+
+FormulaCacheData::FormulaCacheData(size_t c)
+	: capacity(c),
+	  mShards(shardCount(c)),
+	  mShardCapacity((c + mShards.size() - 1) / mShards.size())
+{
+}
+
+uint64_t 
+FormulaCacheData::hash(const char * str, size_t len, uint64_t settings)
+{
+	uint64_t h = mix(settings ^ (uint64_t(len) << 32));
+	// eight characters at once
+	for (; len >= 8; str += 8, len -= 8) {
+		uint64_t w;
+		memcpy(&w, str, 8);
+		h = mix(h ^ w);
+	}
+	if (len > 0) {
+		uint64_t w = 0;
+		memcpy(&w, str, len);
+		h = mix(h ^ w);
+	}
+	return h;
+}
+
+FormulaCacheData::Shard& 
+FormulaCacheData::shard(uint64_t h)
+{
+	// the lower bits select the bucket of the index
+	return mShards[(h >> 48) & (mShards.size() - 1)];
+}
+
+bool 
+FormulaCacheData::find(uint64_t h, const char * str, size_t len, 
+                       uint64_t settings, 
+                       std::vector<CompactElement>& elements)
+{
+	Shard& s = shard(h);
+	std::lock_guard<std::mutex> lock(s.mutex);
+	std::unordered_map<uint64_t, size_t>::const_iterator it = s.index.find(h);
+	if (it != s.index.end())
+	{
+		Entry& e = s.entries[it->second];
+		// verify, different formulas may have the same hash
+		if (e.settings == settings && e.key.length() == len && 
+		    memcmp(e.key.data(), str, len) == 0) 
+		{
+			e.referenced = true;
+			s.hits++;
+			elements.assign(e.elements.begin(), e.elements.end());
+			return true;
+		}
+	}
+	s.misses++;
+	return false;
+}
+
+void 
+FormulaCacheData::insert(uint64_t h, const char * str, size_t len, 
+                         uint64_t settings, const Composition& c)
+{
+	if (mShardCapacity == 0) return;
+	Shard& s = shard(h);
+	std::lock_guard<std::mutex> lock(s.mutex);
+	size_t i = 0;
+	std::unordered_map<uint64_t, size_t>::const_iterator it = s.index.find(h);
+	if (it != s.index.end()) {
+		i = it->second;
+	} else if (s.entries.size() < mShardCapacity) {
+		i = s.entries.size();
+		s.entries.push_back(Entry());
+		s.index[h] = i;
+	} else {
+		while (s.entries[s.hand].referenced) {
+			s.entries[s.hand].referenced = false;
+			s.hand = (s.hand + 1) % s.entries.size();
+		}
+		i = s.hand;
+		s.hand = (s.hand + 1) % s.entries.size();
+		s.index.erase(s.entries[i].hash);
+		s.index[h] = i;
+		s.evictions++;
+	}
+
+	Entry& e = s.entries[i];
+	e.hash = h;
+	e.settings = settings;
+	e.key.assign(str, len);
+	e.elements.clear();
+	for (size_t k = 0; k < c.size(); k++) {
+		e.elements.push_back(c[k]);
+	}
+	e.referenced = false;
+}
+
+void 
+FormulaCacheData::clear(void)
+{
+	for (size_t i = 0; i < mShards.size(); i++) 
+	{
+		Shard& s = mShards[i];
+		std::lock_guard<std::mutex> lock(s.mutex);
+		s.entries.clear();
+		s.index.clear();
+		s.hand = 0;
+		s.hits = 0;
+		s.misses = 0;
+		s.evictions = 0;
+	}
+}
+
+FormulaCache::Statistics 
+FormulaCacheData::statistics(void) const
+{
+	FormulaCache::Statistics stats = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < mShards.size(); i++) 
+	{
+		const Shard& s = mShards[i];
+		std::lock_guard<std::mutex> lock(s.mutex);
+		stats.size      += s.entries.size();
+		stats.hits      += s.hits;
+		stats.misses    += s.misses;
+		stats.evictions += s.evictions;
+	}
+	return stats;
+}
+
+////// FormulaCache //////
+
+FormulaCache::FormulaCache(size_t capacity)
+	: mD(new FormulaCacheData(capacity))
+{
+}
+
+FormulaCache::~FormulaCache()
+{
+	delete mD;
+}
+
+size_t 
+FormulaCache::capacity(void) const
+{
+	return mD->capacity;
+}
+
+FormulaCache::Statistics 
+FormulaCache::statistics(void) const
+{
+	return mD->statistics();
+}
+
+void 
+FormulaCache::clear(void)
+{
+	mD->clear();
+}
@@ -0,0 +1,126 @@
+/*
+ * src/formulacache.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_FORMULACACHE_H
+#define CFP_FORMULACACHE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+#include <cfp/cfp.h>
+#include "composition.h"
+
+namespace cfp
+{
+	/// Implementation data of a FormulaCache.
+	/// The entries are distributed among independently locked shards by
+	/// the hash of their key, so that threads rarely wait for each other
+	/// and a lookup holds a lock only for copying a few elements.
+	/// Each shard holds a fixed number of entries, which are replaced by
+	/// the CLOCK algorithm: a hit marks an entry as referenced, the clock
+	/// hand passes over referenced entries once, clearing the mark, and 
+	/// replaces the first unreferenced one. The memory of replaced 
+	/// entries is reused.
+	class FormulaCacheData
+	{
+	public:
+		/// Creates an empty cache for \e capacity entries.
+		explicit FormulaCacheData(size_t capacity);
+
+		/// Returns the hash of a formula and of the settings which 
+		/// affect its result.
+		static uint64_t 
+		hash(const char * str, size_t len, uint64_t settings);
+
+		/// Looks up a formula.
+		/// \param[in]  h        Hash of the formula, see hash().
+		/// \param[in]  str      The formula.
+		/// \param[in]  len      Number of characters of \e str.
+		/// \param[in]  settings Settings of the Parser.
+		/// \param[out] elements The cached result, if found.
+		/// \returns False, if the formula is not cached.
+		bool 
+		find(uint64_t h, const char * str, size_t len, uint64_t settings,
+		     std::vector<CompactElement>& elements);
+
+		/// Stores the result of a formula. Replaces an entry of the same
+		/// hash or, if the shard is full, the one selected by the clock.
+		/// \param[in] h        Hash of the formula, see hash().
+		/// \param[in] str      The formula.
+		/// \param[in] len      Number of characters of \e str.
+		/// \param[in] settings Settings of the Parser.
+		/// \param[in] c        The result of the formula.
+		void 
+		insert(uint64_t h, const char * str, size_t len, uint64_t settings,
+		       const Composition& c);
+
+		/// Removes all entries and resets the counters.
+		void 
+		clear(void);
+
+		/// Returns the sums of the counters of all shards.
+		FormulaCache::Statistics 
+		statistics(void) const;
+
+		const size_t capacity; //!< Maximum number of entries.
+
+	private:
+		/// A cached result.
+		struct Entry
+		{
+			uint64_t    hash;       //!< Hash of key and settings.
+			uint64_t    settings;   //!< Settings of the Parser.
+			std::string key;        //!< The formula.
+			std::vector<CompactElement> elements; //!< The result.
+			bool        referenced; //!< Used since the clock passed.
+		};
+
+		/// Independently locked part of the cache.
+		struct Shard
+		{
+			Shard() : hand(0), hits(0), misses(0), evictions(0) {}
+
+			mutable std::mutex mutex;   //!< Guards all members.
+			std::vector<Entry> entries; //!< Up to mShardCapacity entries.
+			std::unordered_map<uint64_t, size_t> index; //!< Hash to entry.
+			size_t             hand;      //!< Clock position in entries.
+			size_t             hits;      //!< Successful lookups.
+			size_t             misses;    //!< Failed lookups.
+			size_t             evictions; //!< Replaced entries.
+		};
+
+		/// Returns the shard of a hash.
+		Shard& 
+		shard(uint64_t h);
+
+		std::vector<Shard> mShards;        //!< Number is a power of 2.
+		size_t             mShardCapacity; //!< Entries per shard.
+	};
+} // namespace cfp
+
+#endif // this file
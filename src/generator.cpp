@@ -0,0 +1,255 @@
+/*
+ * src/generator.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <algorithm>
+#include <cfp/generator.h>
+
+using namespace cfp;
+
+namespace {
+
+/// Appends the decimal digits of a number.
+void 
+appendNumber(std::string& str, unsigned n)
+{
+	char digits[12];
+	size_t len = 0;
+	do {
+		digits[len++] = char('0' + n % 10);
+		n /= 10;
+	} while (n > 0);
+	while (len > 0) str += digits[--len];
+}
+
+} // namespace
+
+////// FormulaGenerator::Settings //////
+
+FormulaGenerator::Settings::Settings()
+	: minLength(8),
+	  maxLength(64),
+	  maxDepth(3),
+	  groupProbability(0.1),
+	  maxGroupItems(4),
+	  groupCoefficientProbability(0.7),
+	  countProbability(0.6),
+	  isotopeProbability(0.05),
+	  isotopeNotation(ISOTOPE_MIXED),
+	  decimalProbability(0.02),
+	  commaProbability(0.5),
+	  spaceProbability(0.05),
+	  malformedFraction(0.0)
+{
+	// roughly the composition of organic compounds
+	static const char * const defSymbols[] = {
+		"C", "H", "O", "N", "S", "P", "Cl", "Na", 
+		"K", "Fe", "Cu", "Ca", "Mg", "Si", "Br"
+	};
+	static const double defWeights[] = {
+		30, 40, 10, 6, 2, 1, 2, 2, 
+		1, 1, 1, 1, 1, 1, 1
+	};
+	const size_t count = sizeof(defWeights) / sizeof(defWeights[0]);
+	symbols.assign(defSymbols, defSymbols + count);
+	weights.assign(defWeights, defWeights + count);
+}
+
+////// FormulaGenerator //////
+
+FormulaGenerator::FormulaGenerator(uint64_t s, const Settings& settings)
+	: mState(s)
+{
+	setSettings(settings);
+}
+
+void 
+FormulaGenerator::setSeed(uint64_t s)
+{
+	mState = s;
+}
+
+void 
+FormulaGenerator::setSettings(const Settings& settings)
+{
+	mSettings = settings;
+	if (mSettings.maxGroupItems < 1) mSettings.maxGroupItems = 1;
+	if (mSettings.maxLength < mSettings.minLength) {
+		mSettings.maxLength = mSettings.minLength;
+	}
+	const bool weighted = 
+		mSettings.weights.size() == mSettings.symbols.size();
+	mCumulative.resize(mSettings.symbols.size());
+	double sum = 0.0;
+	for (size_t i = 0; i < mCumulative.size(); i++) {
+		double w = weighted ? mSettings.weights[i] : 1.0;
+		if (w > 0.0) sum += w;
+		mCumulative[i] = sum;
+	}
+}
+
+const FormulaGenerator::Settings& 
+FormulaGenerator::settings(void) const
+{
+	return mSettings;
+}
+
+bool 
+FormulaGenerator::next(std::string& formula)
+{
+	formula.clear();
+	const bool malformed = chance(mSettings.malformedFraction);
+	size_t length = mSettings.minLength + 
+		below(mSettings.maxLength - mSettings.minLength + 1);
+	// an unlimited number of items at the top level
+	appendItems(formula, 0, size_t(-1), length);
+	if (malformed) makeMalformed(formula);
+	return malformed;
+}
+
+uint64_t 
+FormulaGenerator::random(void)
+{
+	uint64_t z = (mState += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+double 
+FormulaGenerator::uniform(void)
+{
+	// 53 bits fill the mantissa of a double exactly
+	return double(random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool 
+FormulaGenerator::chance(double p)
+{
+	return uniform() < p;
+}
+
+size_t 
+FormulaGenerator::below(size_t n)
+{
+	return size_t(random() % uint64_t(n));
+}
+
+void 
+FormulaGenerator::appendCount(std::string& str)
+{
+	if (!chance(mSettings.decimalProbability)) {
+		appendNumber(str, unsigned(2 + below(19)));
+		return;
+	}
+	// digits on both sides of the separator, never zero
+	appendNumber(str, unsigned(below(10)));
+	str += chance(mSettings.commaProbability) ? ',' : '.';
+	str += char('1' + below(9));
+	if (chance(0.5)) str += char('0' + below(10));
+}
+
+bool 
+FormulaGenerator::appendElement(std::string& str, size_t depth, bool prefix)
+{
+	int notation = -1;
+	if (chance(mSettings.isotopeProbability)) {
+		notation = mSettings.isotopeNotation;
+		if (notation == ISOTOPE_MIXED) {
+			notation = chance(0.5) ? ISOTOPE_PREFIX : ISOTOPE_SUFFIX;
+		}
+		// the suffix brackets nest, the prefix fails after other items
+		if (notation == ISOTOPE_PREFIX && !prefix) {
+			notation = ISOTOPE_SUFFIX;
+		}
+		if (notation == ISOTOPE_SUFFIX && depth >= mSettings.maxDepth) {
+			notation = prefix ? ISOTOPE_PREFIX : -1;
+		}
+	}
+	const unsigned nucleons = unsigned(1 + below(250));
+	if (notation == ISOTOPE_PREFIX) appendNumber(str, nucleons);
+
+	if (mCumulative.empty() || mCumulative.back() <= 0.0) {
+		str += 'C';
+	} else {
+		const double x = uniform() * mCumulative.back();
+		size_t i = std::upper_bound(mCumulative.begin(), mCumulative.end(), 
+		                            x) - mCumulative.begin();
+		if (i >= mCumulative.size()) i = mCumulative.size() - 1;
+		str += mSettings.symbols[i];
+	}
+
+	if (notation == ISOTOPE_SUFFIX) {
+		str += '(';
+		appendNumber(str, nucleons);
+		str += ')';
+	}
+	if (!chance(mSettings.countProbability)) return false;
+	appendCount(str);
+	return true;
+}
+
+bool 
+FormulaGenerator::appendItems(std::string& str, size_t depth, 
+                              size_t maxItems, size_t length)
+{
+	static const char open[] = "([{";
+	static const char close[] = ")]}";
+	bool counted = false;
+	for (size_t i = 0; i < maxItems; i++) {
+		if (i > 0 && str.size() >= length) break;
+		const bool space = i > 0 && chance(mSettings.spaceProbability);
+		if (space) str += ' ';
+		// a number after a count reads as part of it without space
+		const bool prefix = i == 0 || (counted && space);
+		if (depth < mSettings.maxDepth && 
+		    chance(mSettings.groupProbability)) 
+		{
+			const size_t b = below(3);
+			str += open[b];
+			appendItems(str, depth + 1, 1 + below(mSettings.maxGroupItems), 
+			            length);
+			str += close[b];
+			counted = chance(mSettings.groupCoefficientProbability);
+			if (counted) appendCount(str);
+		} else {
+			counted = appendElement(str, depth, prefix);
+		}
+	}
+	return counted;
+}
+
+void 
+FormulaGenerator::makeMalformed(std::string& str)
+{
+	const size_t pos = below(str.size() + 1);
+	switch (below(5)) {
+	case 0:  str.insert(pos, 1, '$'); break;  // invalid character
+	case 1:  str.insert(pos, 1, ')'); break;  // unbalanced brackets
+	case 2:  str.insert(pos, 1, '('); break;
+	case 3:  str.insert(pos, ".."); break;    // invalid number
+	default: str.insert(0, 1, 'x'); break;    // lower case symbol
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * src/mappedfile.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+	#define CFP_NO_MMAP
+	#include <fstream>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace cfp;
+
+MappedFile::MappedFile(const char * path)
+	: mData(NULL), mSize(0), mMapped(false), mValid(false)
+{
+#ifndef CFP_NO_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return;
+	}
+	mSize = size_t(st.st_size);
+	if (mSize > 0) 
+	{
+		void * p = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			close(fd);
+			mSize = 0;
+			return;
+		}
+		// the file is read front to back
+		madvise(p, mSize, MADV_SEQUENTIAL);
+		mData = static_cast<const char *>(p);
+		mMapped = true;
+	}
+	// the mapping stays valid without the descriptor
+	close(fd);
+	mValid = true;
+#else
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file) return;
+	file.seekg(0, std::ios::end);
+	mBuffer.resize(size_t(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	if (!mBuffer.empty() && !file.read(&mBuffer[0], mBuffer.size())) {
+		mBuffer.clear();
+		return;
+	}
+	mSize = mBuffer.size();
+	if (mSize > 0) mData = &mBuffer[0];
+	mValid = true;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef CFP_NO_MMAP
+	if (mMapped) munmap(const_cast<char *>(mData), mSize);
+#endif
+}
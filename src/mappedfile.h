@@ -0,0 +1,72 @@
+/*
+ * src/mappedfile.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_MAPPEDFILE_H
+#define CFP_MAPPEDFILE_H
+
+#include <cstddef>
+#include <vector>
+
+namespace cfp
+{
+	/// Read-only view of the content of a file.
+	/// The file is memory mapped where supported, otherwise it is read 
+	/// into memory at once. Nothing is thrown if the file can not be 
+	/// read, see valid().
+	class MappedFile
+	{
+	public:
+		/// Maps the file at \e path.
+		explicit MappedFile(const char * path);
+
+		/// Unmaps the file.
+		~MappedFile();
+
+		/// Tells if the file was read. Otherwise it appears empty.
+		bool 
+		valid(void) const { return mValid; }
+
+		/// Returns the first character of the file.
+		const char * 
+		data(void) const { return mData; }
+
+		/// Returns the number of characters of the file.
+		size_t 
+		size(void) const { return mSize; }
+
+	private:
+		MappedFile(const MappedFile&);            //!< Not copyable.
+		MappedFile& operator=(const MappedFile&); //!< Not copyable.
+
+		const char *      mData;   //!< Content of the file.
+		size_t            mSize;   //!< Length of the content.
+		bool              mMapped; //!< True, if mData is a mapping.
+		bool              mValid;  //!< False, if the file is unreadable.
+		std::vector<char> mBuffer; //!< Content, if not mapped.
+	};
+} // namespace cfp
+
+#endif // this file
@@ -26,11 +26,310 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstring>
 #include <cfp/cfp.h>
 #include "parserstate.h"
+#include "workdistributor.h"
+#include "mappedfile.h"
+#include "formulacache.h"
+
+/// Number of formulas handed to a thread at once by 
+/// Parser::parseBatchParallel.
+#define BATCH_CHUNK_SIZE 256
+
+/// Number of bytes of a file handed to a thread at once by 
+/// Parser::parseFile.
+#define FILE_BLOCK_SIZE (256*1024)
+
+/// Failures of worker threads, like those of a BatchSink, are caught and
+/// passed on to the calling thread. Without exception support there is
+/// nothing to catch.
+#ifndef CFP_NO_EXCEPTIONS
+	#define CFP_TRY       try
+	#define CFP_CATCH_ALL catch (...)
+#else
+	#define CFP_TRY       if (true)
+	#define CFP_CATCH_ALL else
+#endif
 
 using namespace cfp;
 
+namespace {
+
+/// Guards the statistics of a Parser while the const batch functions 
+/// add the counters of their threads. Unlike the rest of the Parser,
+/// these may be run by several threads at the same time.
+std::mutex statisticsMutex;
+
+/// Shared data of the threads of Parser::parseBatchParallel.
+struct ParallelBatch
+{
+	const Parser&               settings; //!< Parser to copy.
+	const FormulaView *         formulas; //!< All formulas.
+	size_t                      count;    //!< Number of formulas.
+	std::vector<BatchResult>    chunks;   //!< Output of each chunk.
+	WorkDistributor             work;     //!< Chunks left to process.
+	std::vector<std::exception_ptr> errors; //!< Failure of each thread.
+	std::vector<Parser::Statistics> statistics; //!< Counters of each thread.
+
+	/// Prepares the output for \e chunkCount chunks and \e threads
+	/// threads.
+	ParallelBatch(const Parser& p, const FormulaView * f, size_t n, 
+	              size_t chunkCount, size_t threads)
+		: settings(p), formulas(f), count(n), 
+		  chunks(chunkCount), work(chunkCount, threads), errors(threads),
+		  statistics(threads)
+	{}
+
+	/// Processes chunks until none are left.
+	/// \param[in] worker Index of the calling thread.
+	void 
+	run(size_t worker)
+	{
+		CFP_TRY {
+			Parser p(settings);
+			size_t chunk = 0;
+			while (work.next(worker, chunk))
+			{
+				size_t first = chunk * BATCH_CHUNK_SIZE;
+				size_t n = std::min(size_t(BATCH_CHUNK_SIZE), count - first);
+				p.parseBatch(formulas + first, n, chunks[chunk]);
+			}
+			statistics[worker] = p.statistics();
+		} CFP_CATCH_ALL {
+			errors[worker] = std::current_exception();
+		}
+	}
+};
+
+/// Shared data of the threads of Parser::parseFile.
+/// The file is split into blocks of FILE_BLOCK_SIZE bytes, which are
+/// taken by the threads in file order. A block consists of the lines 
+/// starting within it. The results of a block are passed to the sink 
+/// after the ones of all preceding blocks.
+struct ParallelFile
+{
+	const Parser&       settings;   //!< Parser to copy.
+	const char *        data;       //!< Content of the file.
+	size_t              size;       //!< Length of the content.
+	char                separator;  //!< End of the ID column, or 0.
+	size_t              blockCount; //!< Number of blocks.
+	BatchSink&          sink;       //!< Receives the results.
+	std::atomic<size_t> nextBlock;  //!< Next block to parse.
+	std::mutex          mutex;      //!< Guards the members below.
+	std::condition_variable turn;   //!< Signals a change of emitted.
+	size_t              emitted;    //!< Number of blocks passed to sink.
+	size_t              lines;      //!< Number of lines passed to sink.
+	std::exception_ptr  error;      //!< First failure of any thread.
+	Parser::Statistics  statistics; //!< Counters of all threads.
+
+	ParallelFile(const Parser& p, const MappedFile& f, char sep, 
+	             BatchSink& s)
+		: settings(p), data(f.data()), size(f.size()), separator(sep),
+		  blockCount((f.size() + FILE_BLOCK_SIZE - 1) / FILE_BLOCK_SIZE),
+		  sink(s), nextBlock(0), emitted(0), lines(0)
+	{}
+
+	/// Returns the beginning of the first line starting at or after 
+	/// \e pos.
+	size_t 
+	lineStart(size_t pos) const
+	{
+		if (pos == 0) return 0;
+		if (pos >= size) return size;
+		const void * nl = memchr(data + pos - 1, '\n', size - pos + 1);
+		if (!nl) return size;
+		return size_t(static_cast<const char *>(nl) - data) + 1;
+	}
+
+	/// Splits the lines starting in [begin, end) into their columns.
+	void 
+	split(size_t begin, size_t end, std::vector<FormulaView>& ids, 
+	      std::vector<FormulaView>& formulas) const
+	{
+		ids.clear();
+		formulas.clear();
+		while (begin < end)
+		{
+			const char * line = data + begin;
+			const void * nl = memchr(line, '\n', size - begin);
+			size_t len = nl ? size_t(static_cast<const char *>(nl) - line)
+			                : size - begin;
+			begin += len + 1;
+			if (len > 0 && line[len-1] == '\r') len--;
+
+			FormulaView formula = { line, len };
+			if (separator) 
+			{
+				FormulaView id = { line, 0 };
+				const void * sep = memchr(line, separator, len);
+				if (sep) {
+					id.len = size_t(static_cast<const char *>(sep) - line);
+					formula.str = line + id.len + 1;
+					formula.len = len - id.len - 1;
+				}
+				ids.push_back(id);
+			}
+			formulas.push_back(formula);
+		}
+	}
+
+	/// Processes blocks until none are left or a thread failed.
+	void 
+	run(void)
+	{
+		CFP_TRY {
+			Parser p(settings);
+			std::vector<FormulaView> ids, formulas;
+			BatchResult result;
+			size_t block;
+			while ((block = nextBlock++) < blockCount)
+			{
+				split(lineStart(block * FILE_BLOCK_SIZE), 
+				      lineStart((block+1) * FILE_BLOCK_SIZE), 
+				      ids, formulas);
+				if (!formulas.empty()) {
+					p.parseBatch(&formulas[0], formulas.size(), result);
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				while (emitted != block && !error) turn.wait(lock);
+				if (error) return;
+				if (!formulas.empty()) {
+					sink.consume(lines, ids.empty() ? NULL : &ids[0], 
+					             &formulas[0], result);
+				}
+				lines += formulas.size();
+				emitted++;
+				turn.notify_all();
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			statistics += p.statistics();
+		} CFP_CATCH_ALL {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) error = std::current_exception();
+			turn.notify_all();
+		}
+	}
+};
+
+/// Appends the results of Parser::parseFile to a single BatchResult.
+struct BatchCollector: public BatchSink
+{
+	BatchResult& result; //!< Output.
+
+	explicit BatchCollector(BatchResult& r)
+		: result(r)
+	{}
+
+	void 
+	consume(size_t, const FormulaView *, const FormulaView *, 
+	        const BatchResult& r)
+	{
+		result.append(r);
+	}
+};
+
+/// Restores the mode of a Parser and releases its formula at the end 
+/// of Parser::parseBatch, also if it is left by an exception.
+struct BatchModeGuard
+{
+	ParserState& state;         //!< State of the Parser.
+	const bool   empiricalOnly; //!< Previous mode.
+
+	explicit BatchModeGuard(ParserState& s)
+		: state(s), empiricalOnly(s.empiricalOnly)
+	{
+		state.empiricalOnly = true;
+	}
+
+	~BatchModeGuard()
+	{
+		state.empiricalOnly = empiricalOnly;
+		state.reset(NULL, 0);
+	}
+};
+
+/// Lets a ParserState collect all errors into a vector while it exists.
+struct RecoveryGuard
+{
+	ParserState& state; //!< State of the Parser.
+
+	RecoveryGuard(ParserState& s, std::vector<Status>& diagnostics)
+		: state(s)
+	{
+		state.diagnostics = &diagnostics;
+	}
+
+	~RecoveryGuard()
+	{
+		state.diagnostics = NULL;
+	}
+};
+
+/// Returns the settings of a parser which affect the result of a 
+/// formula, as part of the key of a FormulaCache.
+inline uint64_t 
+cacheSettings(const ParserState& s)
+{
+	return (uint64_t(s.maxNestingLevel) << 8) | 
+	       (uint64_t(s.elementOrder) << 1) | uint64_t(s.strictSymbols);
+}
+
+} // namespace
+
+Parser::Statistics::Statistics()
+{
+	clear();
+}
+
+void 
+Parser::Statistics::clear(void)
+{
+	formulas = 0;
+	characters = 0;
+	std::fill(tokens, tokens + TOKEN_COUNT, size_t(0));
+	groups = 0;
+	maxDepth = 0;
+	treeNodes = 0;
+	mergedElements = 0;
+	std::fill(errors, errors + ERROR_CODE_COUNT, size_t(0));
+	allocatedBytes = 0;
+	std::fill(nanoseconds, nanoseconds + STAGE_COUNT, uint64_t(0));
+}
+
+Parser::Statistics& 
+Parser::Statistics::operator+=(const Parser::Statistics& s)
+{
+	formulas += s.formulas;
+	characters += s.characters;
+	for (size_t i = 0; i < TOKEN_COUNT; i++) tokens[i] += s.tokens[i];
+	groups += s.groups;
+	maxDepth = std::max(maxDepth, s.maxDepth);
+	treeNodes += s.treeNodes;
+	mergedElements += s.mergedElements;
+	for (size_t i = 0; i < ERROR_CODE_COUNT; i++) errors[i] += s.errors[i];
+	allocatedBytes += s.allocatedBytes;
+	for (size_t i = 0; i < STAGE_COUNT; i++) nanoseconds[i] += s.nanoseconds[i];
+	return *this;
+}
+
+bool 
+Parser::Statistics::available(void)
+{
+#ifndef CFP_NO_STATISTICS
+	return true;
+#else
+	return false;
+#endif
+}
+
 Parser::Parser()
 	: mD(new ParserState())
 {
@@ -47,11 +346,42 @@ Parser::Parser(const Parser& p)
 {
 }
 
+Parser::Parser(Parser&& p) noexcept
+	: mD(p.mD)
+{
+	p.mD = NULL;
+}
+
 Parser::~Parser()
 {
 	delete mD;
 }
 
+Parser& 
+Parser::operator=(const Parser& p)
+{
+	if (this != &p) {
+		// the state refers to its own node pool and formula, a new 
+		// copy keeps these references consistent
+		Parser tmp(p);
+		swap(tmp);
+	}
+	return *this;
+}
+
+Parser& 
+Parser::operator=(Parser&& p) noexcept
+{
+	swap(p);
+	return *this;
+}
+
+void 
+Parser::swap(Parser& p) throw()
+{
+	std::swap(mD, p.mD);
+}
+
 void
 Parser::setFormula(const std::string& formula)
 {
@@ -64,17 +394,22 @@ Parser::setFormula(const char * formula, const size_t len)
 	mD->reset(formula, len);
 }
 
+void
+Parser::setFormulaView(const char * formula, const size_t len)
+{
+	mD->resetView(formula, len);
+}
+
 const std::string& 
 Parser::formula() const
 {
-	return mD->formula;
+	return mD->ownedFormula();
 }
 
 void 
 Parser::setMaxNestingLevel(size_t lvl)
 {
 	mD->maxNestingLevel = lvl;
-	mD->curNestingLevel = lvl;
 }
 
 size_t 
@@ -83,10 +418,88 @@ Parser::maxNestingLevel() const
 	return mD->maxNestingLevel;
 }
 
+void 
+Parser::setStrictSymbols(bool strict)
+{
+	mD->strictSymbols = strict;
+}
+
+bool 
+Parser::strictSymbols() const
+{
+	return mD->strictSymbols;
+}
+
+void 
+Parser::setElementOrder(ElementOrder order)
+{
+	mD->elementOrder = order;
+}
+
+ElementOrder 
+Parser::elementOrder() const
+{
+	return mD->elementOrder;
+}
+
+void 
+Parser::setEmpiricalOnly(bool empiricalOnly)
+{
+	mD->empiricalOnly = empiricalOnly;
+}
+
+bool 
+Parser::empiricalOnly() const
+{
+	return mD->empiricalOnly;
+}
+
+void 
+Parser::setCache(FormulaCache * cache)
+{
+	mD->cache = cache;
+}
+
+FormulaCache * 
+Parser::cache() const
+{
+	return mD->cache;
+}
+
+const Parser::Statistics& 
+Parser::statistics() const
+{
+	return mD->statistics;
+}
+
+void 
+Parser::resetStatistics()
+{
+	mD->statistics.clear();
+}
+
+void 
+Parser::setStageTiming(bool timing)
+{
+	mD->stageTiming = timing;
+}
+
+bool 
+Parser::stageTiming() const
+{
+	return mD->stageTiming;
+}
+
 const Compound& 
 Parser::empirical() const
 {
-	return mD->rootGroup.flatList();
+	return mD->rootGroup().flatList();
+}
+
+const CompactCompound& 
+Parser::compactEmpirical() const
+{
+	return mD->rootGroup().compactList();
 }
 
 const Compound& 
@@ -97,20 +510,286 @@ Parser::process(const char * formula, const size_t len)
 	return empirical();
 }
 
+const Compound& 
+Parser::processView(const char * formula, const size_t len)
+{
+	setFormulaView(formula, len);
+	process();
+	return empirical();
+}
+
 void 
 Parser::process()
 {
-	if (!mD || mD->formula.empty()) return;
+	const Status s = tryProcess();
+	if (!s.ok()) throwError(s);
+}
+
+Status 
+Parser::tryProcess(const char * formula, const size_t len)
+{
+	setFormula(formula, len);
+	return tryProcess();
+}
+
+Status 
+Parser::tryProcessView(const char * formula, const size_t len)
+{
+	setFormulaView(formula, len);
+	return tryProcess();
+}
+
+const Compound& 
+Parser::edit(size_t offset, size_t removed, const char * text, size_t len)
+{
+	const Status s = tryEdit(offset, removed, text, len);
+	if (!s.ok()) throwError(s);
+	return empirical();
+}
+
+Status 
+Parser::tryEdit(size_t offset, size_t removed, const char * text, 
+                size_t len)
+{
+	const Status success = { ERROR_NONE, 0, 0 };
+	if (!mD) return success;
+	if (mD->empiricalOnly) {
+		// no tree to reuse, the cache applies as usual
+		mD->edit(offset, removed, text, text ? len : 0);
+		return tryProcess();
+	}
+	const Status& s = mD->reparse(offset, removed, text, len);
+	mD->countAllocations();
+	if (!s.ok()) return s;
+	mD->flatten();
+	return success;
+}
+
+Status 
+Parser::tryProcess()
+{
+	const Status success = { ERROR_NONE, 0, 0 };
+	if (!mD || mD->inputLen == 0) return success;
+
+	FormulaCacheData * cache = NULL;
+	uint64_t settings = 0, hash = 0;
+	if (mD->cache && mD->empiricalOnly) 
+	{
+		cache = mD->cache->mD;
+		settings = cacheSettings(*mD);
+		hash = cache->hash(mD->input, mD->inputLen, settings);
+		if (cache->find(hash, mD->input, mD->inputLen, settings, mD->cached)) 
+		{
+			CFP_COUNT(mD->statistics.formulas++);
+			mD->rootGroup().assignComposition(mD->cached);
+			mD->flatten();
+			return success;
+		}
+	}
+	const Status& s = mD->parse();
+	mD->countAllocations();
+	if (!s.ok()) return s;
+	mD->flatten();
+	if (cache) {
+		cache->insert(hash, mD->input, mD->inputLen, settings, 
+		              mD->rootGroup().composition());
+	}
+	return success;
+}
+
+Status 
+Parser::validate(const char * formula, const size_t len)
+{
+	return mD->validate(formula, formula ? len : 0);
+}
+
+void 
+Parser::validateBatch(const FormulaView * formulas, size_t count, 
+                      std::vector<Status>& result)
+{
+	result.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		result[i] = mD->validate(formulas[i].str, formulas[i].len);
+	}
+}
+
+size_t 
+Parser::diagnose(std::vector<Status>& diagnostics)
+{
+	if (!mD || mD->inputLen == 0) return 0;
+
+	const size_t before = diagnostics.size();
+	{
+		RecoveryGuard recovery(*mD, diagnostics);
+		mD->parse();
+	}
+	mD->countAllocations();
+	const size_t count = diagnostics.size() - before;
+	if (count == 0) mD->flatten();
+	return count;
+}
+
+size_t 
+Parser::diagnoseView(const char * formula, const size_t len, 
+                     std::vector<Status>& diagnostics)
+{
+	setFormulaView(formula, len);
+	return diagnose(diagnostics);
+}
+
+void 
+Parser::diagnoseBatch(const FormulaView * formulas, size_t count, 
+                      BatchDiagnostics& result)
+{
+	result.clear();
+	result.offsets.reserve(count+1);
+
+	BatchModeGuard guard(*mD);
+	for (size_t i = 0; i < count; i++)
+	{
+		result.offsets.push_back(result.diagnostics.size());
+		mD->resetView(formulas[i].str, formulas[i].len);
+		diagnose(result.diagnostics);
+	}
+	result.offsets.push_back(result.diagnostics.size());
+}
+
+void 
+Parser::parseBatch(const FormulaView * formulas, size_t count, 
+                   BatchResult& result)
+{
+	result.clear();
+	result.offsets.reserve(count+1);
+	result.status.reserve(count);
+	result.errorStart.reserve(count);
+	result.errorLength.reserve(count);
+
+	BatchModeGuard guard(*mD);
+	for (size_t i = 0; i < count; i++)
+	{
+		result.offsets.push_back(result.symbols.size());
+		mD->resetView(formulas[i].str, formulas[i].len);
+		const Status s = tryProcess();
+		result.status.push_back(s.code);
+		result.errorStart.push_back(s.start);
+		result.errorLength.push_back(s.length);
+		if (!s.ok()) continue;
+
+		const Composition& c = mD->rootGroup().composition();
+		for (size_t k = 0; k < c.size(); k++) {
+			result.symbols.push_back(c[k].symbolId());
+			result.nucleons.push_back(c[k].nucleons());
+			result.coefficients.push_back(c[k].coefficient());
+		}
+	}
+	result.offsets.push_back(result.symbols.size());
+}
+
+void 
+Parser::parseBatchParallel(const FormulaView * formulas, size_t count, 
+                           BatchResult& result, size_t threads) const
+{
+	const size_t chunkCount = (count + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads > chunkCount) threads = chunkCount;
+	if (threads <= 1) {
+		Parser p(*this);
+		p.parseBatch(formulas, count, result);
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		mD->statistics += p.statistics();
+		return;
+	}
+
+	ParallelBatch batch(*this, formulas, count, chunkCount, threads);
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++) {
+		workers.push_back(std::thread(&ParallelBatch::run, &batch, t));
+	}
+	batch.run(0);
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	for (size_t t = 0; t < threads; t++) {
+		if (batch.errors[t]) std::rethrow_exception(batch.errors[t]);
+	}
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		for (size_t t = 0; t < threads; t++) {
+			mD->statistics += batch.statistics[t];
+		}
+	}
+
+	size_t elements = 0;
+	for (size_t c = 0; c < chunkCount; c++) {
+		elements += batch.chunks[c].symbols.size();
+	}
+	result.clear();
+	result.offsets.reserve(count+1);
+	result.status.reserve(count);
+	result.errorStart.reserve(count);
+	result.errorLength.reserve(count);
+	result.symbols.reserve(elements);
+	result.nucleons.reserve(elements);
+	result.coefficients.reserve(elements);
+	for (size_t c = 0; c < chunkCount; c++) {
+		result.append(batch.chunks[c]);
+	}
+}
+
+void 
+Parser::parseFile(const char * path, BatchSink& sink, char idSeparator,
+                  size_t threads) const
+{
+	const Status s = tryParseFile(path, sink, idSeparator, threads);
+	if (!s.ok()) throwError(s);
+}
 
-	mD->parse();
-	mD->rootGroup.flatten();
+Status 
+Parser::tryParseFile(const char * path, BatchSink& sink, char idSeparator,
+                     size_t threads) const
+{
+	MappedFile file(path);
+	if (!file.valid()) {
+		const Status failure = { ERROR_FILE_ACCESS, 0, 0 };
+		return failure;
+	}
+	ParallelFile work(*this, file, idSeparator, sink);
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads > work.blockCount) threads = work.blockCount;
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++) {
+		workers.push_back(std::thread(&ParallelFile::run, &work));
+	}
+	work.run();
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	if (work.error) std::rethrow_exception(work.error);
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		mD->statistics += work.statistics;
+	}
+	const Status success = { ERROR_NONE, 0, 0 };
+	return success;
+}
+
+void 
+Parser::parseFile(const char * path, BatchResult& result, char idSeparator,
+                  size_t threads) const
+{
+	result.clear();
+	BatchCollector collector(result);
+	parseFile(path, collector, idSeparator, threads);
+	if (result.offsets.empty()) result.offsets.push_back(0);
 }
 
 std::string 
 Parser::toMarkup(void) const
 {
+	if (mD->empiricalOnly) return cfp::toMarkup(empirical());
 	std::stringstream ss;
-	ss << mD->rootGroup;
+	ss << mD->rootGroup();
 	return ss.str();
 }
 
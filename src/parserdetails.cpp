@@ -25,8 +25,11 @@
  */
 
 #include <iostream>
+#include <algorithm>
 #include <cfp/cfp.h>
 #include "parserstate.h"
+#include "charclass.h"
+#include "symboltable.h"
 
 using namespace cfp;
 
@@ -36,33 +39,46 @@ void
 ElementGroup::addToken(ParserState& s)
 {
 	if (s.token().length() == 0) return;
-	(this->*mAddTokenFunctions.at(s.token().type))(s);
+	(this->*mAddTokenFunctions[s.token().type])(s);
 }
 
 void
 ElementGroup::addTokenSymbol(ParserState& s)
 {
+	CFP_COUNT(s.statistics.tokens[Parser::Statistics::TOKEN_SYMBOL]++);
+	const char * str = s.input + s.token().position();
+	size_t len = s.token().length();
+	SymbolId id = periodicSymbolId(str, len);
+	if (!id)
+	{
+		if (s.strictSymbols) {
+			s.fail(ERROR_UNKNOWN_SYMBOL, s.token().position(), len);
+			return;
+		}
+		id = symbolId(str, len);
+	}
 	// last element has symbol or is list
 	if ( empty() || 
-	    !back().symbol().empty() ||
+	     back().symbolId() != 0 ||
 	     back().isGroup())
 	{
-		add(CompoundGroupElement());
+		addElement();
 	}
-	back().setSymbol( s.token().toString() );
+	back().assignSymbol(str, len, id);
 	mLastElementProperty = SYMBOL_PROPERTY;
 }
 
 void
 ElementGroup::addTokenInt(ParserState& s)
 {
+	CFP_COUNT(s.statistics.tokens[Parser::Statistics::TOKEN_INT]++);
 	if (empty() || mLastElementProperty == COEFFICIENT_PROPERTY)
 	{
-		add(CompoundGroupElement());
-		back().setNucleons( s.token().toInt() );
+		addElement();
+		back().setNucleons( s.token().toInt(s.input) );
 		mLastElementProperty = NUCLEON_PROPERTY;
 	} else {
-		back().setCoefficient( s.token().toDouble() );
+		back().setCoefficient( s.token().toDouble(s.input) );
 		mLastElementProperty = COEFFICIENT_PROPERTY;
 	}
 }
@@ -70,16 +86,12 @@ ElementGroup::addTokenInt(ParserState& s)
 void
 ElementGroup::addTokenFloat(ParserState& s)
 {
+	CFP_COUNT(s.statistics.tokens[Parser::Statistics::TOKEN_FLOAT]++);
 	if (empty() || mLastElementProperty == COEFFICIENT_PROPERTY)
 	{
-		size_t pos = 0;
-		size_t width = size_t(s.token().length());
-		// get the start position of this symbol, we're behind it
-		if (s.curPos >= width) 
-			pos = s.curPos - width;
-		throw ErrorStartWithCoef(pos, 1);
+		s.fail(ERROR_START_WITH_COEF, s.token().position(), 1);
 	} else {
-		back().setCoefficient( s.token().toDouble() );
+		back().setCoefficient( s.token().toDouble(s.input) );
 		mLastElementProperty = COEFFICIENT_PROPERTY;
 	}
 }
@@ -95,25 +107,31 @@ ElementGroup::addTokenNone(ParserState& s)
 }
 
 void
-ElementGroup::addSubgroup(const ElementGroup& subGrp, size_t strIdx)
+ElementGroup::addSubgroup(ParserState& s, ElementGroup& subGrp, size_t strIdx)
 {
-	if (subGrp.empty() ) return;
+	if (subGrp.empty() ) {
+		dropSubgroup();
+		return;
+	}
 
 	if (!empty() &&
 	    !back().isGroup() &&
-	     back().symbol().empty() ) // no symbol yet
+	     back().symbolId() == 0 ) // no symbol yet
 	{
 		// we add a valid group and the last element is not ready yet
-		throw ErrorLoneNucleonNum(strIdx, 1);
+		dropSubgroup();
+		s.fail(ERROR_LONE_NUCLEON_NUM, strIdx, 1);
+		return;
 	}
 	if ( subGrp.size() == 1 && // single element
 	    !subGrp.back().isGroup() && // not a list
-	     subGrp.back().symbol().empty() && // no symbol but nucleon number
+	     subGrp.back().symbolId() == 0 && // no symbol but nucleon number
 	     subGrp.back().isIsotope() )
 	{
+		dropSubgroup();
 		if (empty())
 		{
-			throw ErrorLoneNucleonNum(strIdx, 1);
+			s.fail(ERROR_LONE_NUCLEON_NUM, strIdx, 1);
 		} else {
 			back().setNucleons(
 				subGrp.back().nucleons() );
@@ -129,180 +147,573 @@ ElementGroup::addSubgroup(const ElementGroup& subGrp, size_t strIdx)
 
 ///// ParserState /////
 
-/// Tests for upper case characters.
-#define IS_ALPHA_U(c) (( 65 <= (c)) && ((c) <= 90 ))
+namespace {
 
-/// Tests for lower case characters.
-#define IS_ALPHA_L(c) (( 97 <= (c)) && ((c) <= 122))
-
-/// Tests for alphabetic characters.
-#define IS_ALPHA(c)   (IS_ALPHA_U((c)) || IS_ALPHA_L((c)))
-
-/// Tests for numerical characters.
-#define IS_NUM(c)     (( 48 <= (c)) && ((c) <= 57 ))
+/// Actions of the lexer, see transitionTable.
+typedef enum
+{
+	ACT_APPEND,       //!< Appends the run of characters to the current Token.
+	ACT_APPEND_DECIM, //!< Appends a decimal separator to the current Token.
+	ACT_NEW,          //!< Translates the current Token, starts a new one.
+	ACT_END,          //!< Translates the current Token.
+	ACT_SKIP,         //!< Ignores the character.
+	ACT_BRACKET_O,    //!< Enters a new group.
+	ACT_BRACKET_C,    //!< Leaves the current group.
+	ACT_ERR_INVALID,  //!< Fails with ERROR_INVALID_CHAR.
+	ACT_ERR_LOWER,    //!< Fails with ERROR_SYM_BEG_LOW_CHAR.
+	ACT_ERR_DECIM     //!< Fails with ERROR_DECIM_BETW_INT.
+} Action;
 
-/// Tests for the space character.
-#define IS_SPACE(c)    ( 32 == (c))
+/// Lexer action and the resulting Token::Type.
+struct Transition
+{
+	unsigned char action; //!< The Action to perform.
+	unsigned char type;   //!< The Token::Type afterwards.
+};
 
-/// Tests for decimal separators , .
-#define IS_DECIM(c)   (( 44 == (c)) || ((c) == 46 ))
+#define T_SYM   Token::TYPE_SYMBOL
+#define T_INT   Token::TYPE_INT
+#define T_FLOAT Token::TYPE_FLOAT
+#define T_NONE  Token::TYPE_NONE
+#define INVALID { ACT_ERR_INVALID, T_NONE }
+#define ERR_LOW { ACT_ERR_LOWER,   T_NONE }
+#define ERR_DEC { ACT_ERR_DECIM,   T_NONE }
+#define OPEN    { ACT_BRACKET_O,   T_NONE }
+#define CLOSE   { ACT_BRACKET_C,   Token::TYPE_GROUP }
 
-/// Tests for opening brackets ( [ {
-#define IS_BRACKET_O(c) (( 40 == (c)) || ( 91 == (c)) || (123 == (c)))
+/// State transitions of the lexer. The type of the current Token is the
+/// state, the row index. The CharClass of the next character is the 
+/// column index. Group and none tokens are always empty, they behave the 
+/// same.
+const Transition transitionTable[Token::TYPE_NONE+1][CHAR_CLASS_COUNT] = {
+//        invalid  0-9                 , .                         A-Z                a-z                  ( [ {  ) ] }  space
+/*SYM*/ { INVALID, { ACT_NEW, T_INT }, ERR_DEC,                    { ACT_NEW, T_SYM }, { ACT_APPEND, T_SYM }, OPEN, CLOSE, { ACT_END, T_NONE } },
+/*GRP*/ { INVALID, { ACT_NEW, T_INT }, ERR_DEC,                    { ACT_NEW, T_SYM }, ERR_LOW,             OPEN, CLOSE, { ACT_SKIP, Token::TYPE_GROUP } },
+/*INT*/ { INVALID, { ACT_APPEND, T_INT }, { ACT_APPEND_DECIM, T_FLOAT }, { ACT_NEW, T_SYM }, ERR_LOW,       OPEN, CLOSE, { ACT_END, T_NONE } },
+/*FLT*/ { INVALID, { ACT_APPEND, T_FLOAT }, ERR_DEC,               { ACT_NEW, T_SYM }, ERR_LOW,             OPEN, CLOSE, { ACT_END, T_NONE } },
+/*NON*/ { INVALID, { ACT_NEW, T_INT }, ERR_DEC,                    { ACT_NEW, T_SYM }, ERR_LOW,             OPEN, CLOSE, { ACT_SKIP, T_NONE } }
+};
 
-/// Tests for closing brackets ) ] }
-#define IS_BRACKET_C(c) (((c) == 41 ) || ((c) == 93 ) || ((c) == 125))
+#undef T_SYM
+#undef T_INT
+#undef T_FLOAT
+#undef T_NONE
+#undef INVALID
+#undef ERR_LOW
+#undef ERR_DEC
+#undef OPEN
+#undef CLOSE
 
+/// Sorts errors by their start position, keeping the order of errors at
+/// the same position. An insertion sort, the errors of a formula are few
+/// and mostly sorted already.
 void 
-ParserState::parseNumbers(const char& c)
+sortByPosition(Status * first, Status * last)
 {
-	if (token().type == Token::TYPE_SYMBOL)
-	{
-		// save & transl dep. on previous token
-		currentGroup().addToken(*this);
-		token().clear();
-	}
-	token().append(c);
-	if (token().type != Token::TYPE_FLOAT)
+	for (Status * i = first; i < last; i++)
 	{
-		token().type = Token::TYPE_INT;
+		const Status s = *i;
+		Status * j = i;
+		for (; j > first && (j-1)->start > s.start; j--) *j = *(j-1);
+		*j = s;
 	}
 }
 
+/// Creates the Status of an error.
+inline Status 
+makeStatus(ErrorCode code, size_t start, size_t length)
+{
+	const Status s = { code, start, length };
+	return s;
+}
+
+/// Creates the Status of an error of a token found by 
+/// ParserState::CheckFrame::addToken.
+inline Status 
+tokenError(ErrorCode code, size_t pos, size_t len)
+{
+	// a coefficient is reported by its first character, as by 
+	// ElementGroup::addTokenFloat
+	return makeStatus(code, pos, code == ERROR_START_WITH_COEF ? 1 : len);
+}
+
+} // namespace
+
 void 
-ParserState::parseDecimalOp(const char& c)
+ParserState::parseBracketO(void)
 {
-	if (token().type != Token::TYPE_INT)
-	{
-		throw ErrorDecimBetwInt(curPos, 1);
-	} // allow it after a symbol to begin a new float token with ?
-	if (c == ',') { // is comma
-		token().append('.');
-	} else {
-		token().append(c);
+	// the previous token is translated by scan()
+	if (failed()) return;
+	if (mDepth+1 >= maxNestingLevel) {
+		if (!recovering()) {
+			fail(ERROR_MAX_NESTING, curPos, 1);
+			return;
+		}
+		// the bracket exceeding the limit is reported, the deeper 
+		// levels are parsed as usual to keep the brackets matched
+		if (mDepth+1 == std::max(maxNestingLevel, size_t(1))) {
+			fail(ERROR_MAX_NESTING, curPos, 1);
+		}
 	}
-	token().type = Token::TYPE_FLOAT;
+	pushFrame();
 }
 
 void 
-ParserState::parseAlpha(const char& c)
+ParserState::parseBracketC(void)
 {
-	// continue symbol token
-	if (IS_ALPHA_L(c))
-	{
-		if (token().type == Token::TYPE_SYMBOL)
-		{
-			token().append(c);
-		} 
-		else // prev token.type not symbol
-		{
-			throw ErrorSymBegLowChar(curPos, 1);
-		}
-	} else { // (IS_ALPHA_U(c)) -> new token
-		// save & transl dep. on previous token
-		// create token without coef (==1.0)
+	if (mDepth == 0) {
+		fail(ERROR_LONE_CLOSING_BRACKET, curPos, 1);
+		if (failed()) return;
+		// recovering, the bracket ends the current token only
 		currentGroup().addToken(*this);
 		token().clear();
-		token().append(c);
+		return;
 	}
-	token().type = Token::TYPE_SYMBOL;
+	// translate the last token of this group
+	currentGroup().addToken(*this);
+	if (failed()) return;
+	popFrame();
 }
 
 void 
-ParserState::parseBracketO(const char& c)
+ParserState::failChar(ErrorCode code, CharClass cls)
 {
-	ElementGroup   subGrp;
-	size_t         old_pos = (curPos == 0) ? 0 : curPos-1;
-	// saving work data before recursion
-	ElementGroup * parentGrp = &currentGroup();
-	Token        * parentToken = &token();
-	currentGroup().addToken(*this);
-	try {
-		// call this function (recursion)
-		// recLvl keeps also track of balanced brackets
-		setCurrentGroup(subGrp);
-		curNestingLevel--;
-		curPos++;
-		parse();
-	} 
-	catch(Error& e)
-	{
-		//e.addOffset(offset);
-		throw;
+	if (!recovering()) {
+		fail(code, curPos, 1);
+		return;
 	}
-	// restoring work data
-	setCurrentGroup(*parentGrp);
-	setToken(*parentToken);
-	// adding the result and updating current state
-	currentGroup().addSubgroup(subGrp, old_pos);
-	token().type = Token::TYPE_GROUP;
+	const size_t n = mIndex.runLength(cls, curPos);
+	fail(code, curPos, n);
+	currentGroup().addToken(*this);
 	token().clear();
+	curPos += n-1;
 }
 
 void 
-ParserState::parseBracketC(const char& c)
+ParserState::closeOpenFrames(void)
 {
-	curNestingLevel++;
-	if (curNestingLevel > maxNestingLevel) {
-		throw ErrorLoneClosingBracket(curPos, 1);
+	// reported in the order of the brackets
+	for (size_t d = 1; d <= mDepth; d++) {
+		fail(ERROR_MISSING_CLOSING_BRACKET, mFrames[d].openPos, 1);
+	}
+	while (mDepth > 0) {
+		currentGroup().addToken(*this);
+		popFrame();
 	}
 }
 
 void 
-ParserState::parseSpace(const char& c)
+ParserState::buildIndex(void)
 {
-	if (token().type == Token::TYPE_SYMBOL ||
-	    token().type == Token::TYPE_FLOAT  ||
-	    token().type == Token::TYPE_INT      )
-	{
-		// save & transl dep. on previous token
-		currentGroup().addToken(*this);
-		token().type = Token::TYPE_NONE;
-		token().clear();
+	StageTimer timer(statistics, Parser::Statistics::STAGE_INDEX, 
+	                 stageTiming);
+	mIndex.build(input, inputLen);
+}
+
+bool 
+ParserState::addedNode(size_t i) const
+{
+	const size_t next = (i+1 < mOldCheckpoints.size()) 
+	                    ? mOldCheckpoints[i+1].nodes : mOldNodes;
+	return next > mOldCheckpoints[i].nodes;
+}
+
+bool 
+ParserState::checkpoint(void)
+{
+	if (failed()) return false;
+	ElementGroup& root = rootGroup();
+	Checkpoint c;
+	c.pos = curPos;
+	c.nodes = root.topSize();
+	c.grammar = root.grammarState();
+	c.type = (unsigned char)token().type;
+	mCheckpoints.push_back(c);
+	if (!mReparsing || curPos < mEditEnd) return false;
+	// the same position in the previous formula
+	const size_t q = curPos - mEditEnd + mOldEditEnd;
+	while (mOldNext < mOldCheckpoints.size() && 
+	       mOldCheckpoints[mOldNext].pos < q) {
+		mOldNext++;
 	}
+	if (mOldNext == mOldCheckpoints.size()) return false;
+	const Checkpoint& o = mOldCheckpoints[mOldNext];
+	// the old token there must not have changed the element before it
+	if (o.pos != q || o.type != c.type || !(o.grammar == c.grammar) || 
+	    !addedNode(mOldNext)) {
+		return false;
+	}
+	// the rest of the formula is unchanged, so is its result
+	root.appendTail(mTail, o.nodes - mTailFirst);
+	root.restoreGrammar(mOldGrammar);
+	for (size_t i = mOldNext+1; i < mOldCheckpoints.size(); i++) {
+		Checkpoint n = mOldCheckpoints[i];
+		n.pos = n.pos - q + curPos;
+		n.nodes = n.nodes - o.nodes + c.nodes;
+		mCheckpoints.push_back(n);
+	}
+	return true;
 }
 
-void 
+const Status& 
 ParserState::parse(void)
 {
-	size_t thisFirstPos = (curPos == 0) ? 0 : curPos-1;
-	Token token;
+	// starts over, the mode may have changed
+	clear();
+	const size_t firstDiagnostic = recovering() ? diagnostics->size() : 0;
+	CFP_COUNT(statistics.formulas++);
+	CFP_COUNT(statistics.characters += inputLen);
+	buildIndex();
+	StageTimer timer(statistics, Parser::Statistics::STAGE_PARSE, 
+	                 stageTiming);
+	scan();
+	if (recovering()) {
+		// some errors are found after later ones, e.g. a lone nucleon 
+		// number before a group at its closing bracket
+		Status * d = diagnostics->data();
+		sortByPosition(d + firstDiagnostic, d + diagnostics->size());
+		mStatus = diagnostics->size() > firstDiagnostic 
+		          ? (*diagnostics)[firstDiagnostic] : mStatus;
+	}
+	return mStatus;
+}
 
-	setToken(token);
+const Status& 
+ParserState::reparse(size_t offset, size_t removed, const char * str, 
+                     size_t len)
+{
+	if (!str) len = 0;
+	if (offset > inputLen) offset = inputLen;
+	if (removed > inputLen - offset) removed = inputLen - offset;
+	const bool reuse = mCheckpointsValid && !empiricalOnly && 
+	                   !recovering() &&
+	                   mCheckpointNesting == maxNestingLevel &&
+	                   mCheckpointStrict == strictSymbols;
+	edit(offset, removed, str, len);
+	mCheckpointNesting = maxNestingLevel;
+	mCheckpointStrict = strictSymbols;
+	mRecording = !empiricalOnly && !recovering();
+	if (!reuse) {
+		parse();
+		mRecording = false;
+		mCheckpointsValid = !empiricalOnly && mStatus.ok();
+		return mStatus;
+	}
+	ElementGroup& root = rootGroup();
+	mOldNodes = root.topSize();
+	mOldGrammar = root.grammarState();
+	// resumes before the token containing the edit, at one that did 
+	// not change the element before it
+	size_t r = std::lower_bound(mCheckpoints.begin(), mCheckpoints.end(), 
+	                            offset) - mCheckpoints.begin();
+	bool found = false;
+	while (r > 0 && !found) {
+		r--;
+		const size_t next = (r+1 < mCheckpoints.size()) 
+		                    ? mCheckpoints[r+1].nodes : mOldNodes;
+		found = next > mCheckpoints[r].nodes;
+	}
+	Checkpoint start;
+	if (found) {
+		start = mCheckpoints[r];
+		root.cutTail(start.nodes, mTail);
+		root.restoreGrammar(start.grammar);
+	} else {
+		root.cutTail(0, mTail);
+		root.clear();
+		start.pos = 0;
+		start.nodes = 0;
+		start.grammar = root.grammarState();
+		start.type = Token::TYPE_NONE;
+	}
+	mOldCheckpoints.assign(mCheckpoints.begin() + r, mCheckpoints.end());
+	mCheckpoints.resize(r);
+	mOldNext = 0;
+	mTailFirst = start.nodes;
+	mEditEnd = offset + len;
+	mOldEditEnd = offset + removed;
 
-	if (curNestingLevel == 0) {
-		throw ErrorMaxNesting(thisFirstPos, 1);
+	curPos = start.pos;
+	mDepth = 0;
+	mStatus.code = ERROR_NONE;
+	mStatus.start = 0;
+	mStatus.length = 0;
+	token().clear();
+	token().type = Token::Type(start.type);
+	CFP_COUNT(statistics.formulas++);
+	buildIndex();
+	{
+		StageTimer timer(statistics, Parser::Statistics::STAGE_PARSE, 
+		                 stageTiming);
+		mReparsing = true;
+		scan();
+		mReparsing = false;
 	}
+	CFP_COUNT(statistics.characters += curPos - start.pos);
+	mRecording = false;
+	// the old elements not matched return to the pool
+	mTail.clear();
+	mOldCheckpoints.clear();
+	mCheckpointsValid = mStatus.ok();
+	return mStatus;
+}
 
-	while (curPos < formula.length())
+void 
+ParserState::scan(void)
+{
+	// everything up to the first invalid character is processed,
+	// while recovering invalid characters are skipped
+	const size_t end = recovering() ? inputLen : mIndex.firstInvalid();
+	while (curPos < end)
 	{
-		char c = formula.at(curPos);
-		if (IS_NUM(c)) {
-			parseNumbers(c);
-		} else if (IS_DECIM(c)) {
-			parseDecimalOp(c);
-		} else if (IS_ALPHA(c)) {
-			parseAlpha(c);
-		} else if (IS_BRACKET_O(c)) {
-			parseBracketO(c);
-		} else if (IS_BRACKET_C(c)) {
-			parseBracketC(c);
-			break; // position stays @closingbracket
-		} else if (IS_SPACE(c)) {
-			parseSpace(c);
-			// ignore
-		} else {
-			throw ErrorInvalidChar(curPos, 1);
+		const CharClass cls = charClass(input[curPos]);
+		const Transition& t = transitionTable[token().type][cls];
+		switch (t.action)
+		{
+			case ACT_APPEND: {
+				// the whole run belongs to the current token
+				size_t n = mIndex.runLength(cls, curPos);
+				token().extend(n);
+				curPos += n-1;
+				break;
+			}
+			case ACT_APPEND_DECIM:
+				// a single one, ',' is kept as is
+				token().extend(1);
+				break;
+			case ACT_NEW:
+				// save & transl dep. on previous token
+				currentGroup().addToken(*this);
+				if (mRecording && mDepth == 0 && checkpoint()) return;
+				token().start(curPos);
+				break;
+			case ACT_END:
+				currentGroup().addToken(*this);
+				token().clear();
+				break;
+			case ACT_SKIP:
+				curPos += mIndex.runLength(cls, curPos)-1;
+				break;
+			case ACT_BRACKET_O:
+				currentGroup().addToken(*this);
+				if (mRecording && mDepth == 0 && checkpoint()) return;
+				parseBracketO();
+				break;
+			case ACT_BRACKET_C:
+				parseBracketC();
+				break;
+			case ACT_ERR_LOWER:
+				failChar(ERROR_SYM_BEG_LOW_CHAR, cls);
+				break;
+			case ACT_ERR_DECIM:
+				failChar(ERROR_DECIM_BETW_INT, cls);
+				break;
+			default:
+				failChar(ERROR_INVALID_CHAR, cls);
+				break;
 		}
+		if (failed()) return;
+		token().type = Token::Type(t.type);
 		curPos++;
 	}
-	if (curPos >= formula.length() && curNestingLevel < maxNestingLevel) {
-		// does never match if last was a closing bracket 
-		// (position stays at it)
-		throw ErrorMissingClosingBracket(thisFirstPos, 1);
+	if (curPos < inputLen) {
+		fail(ERROR_INVALID_CHAR, curPos, 1);
+	} else if (mDepth > 0 && !recovering()) {
+		// the innermost group is still open
+		fail(ERROR_MISSING_CLOSING_BRACKET, frame().openPos, 1);
+	} else {
+		closeOpenFrames();
+		// translate the last token read in
+		currentGroup().addToken(*this);
 	}
-	// translate the last token read in
-	currentGroup().addToken(*this);
-	// throws exception std::out_of_range, cfp::Error
 }
 
+///// Validation /////
+
+void 
+ParserState::CheckFrame::clear(size_t pos)
+{
+	count = 0;
+	backSymbol = backGroup = backIsotope = false;
+	lastProperty = NO_PROPERTY;
+	openPos = pos;
+}
+
+void 
+ParserState::CheckFrame::addElement(bool isGroup)
+{
+	count++;
+	backSymbol = false;
+	backGroup = isGroup;
+	backIsotope = false;
+}
+
+ErrorCode 
+ParserState::CheckFrame::addToken(const ParserState& s, Token::Type type, 
+                                  const char * str, size_t pos, size_t len)
+{
+	if (len == 0) return ERROR_NONE;
+	switch (type)
+	{
+		case Token::TYPE_SYMBOL:
+			if (s.strictSymbols && !periodicSymbolId(str + pos, len)) 
+			{
+				return ERROR_UNKNOWN_SYMBOL;
+			}
+			if (count == 0 || backSymbol || backGroup) addElement(false);
+			backSymbol = true;
+			lastProperty = SYMBOL_PROPERTY;
+			break;
+		case Token::TYPE_INT:
+			if (count == 0 || lastProperty == COEFFICIENT_PROPERTY) {
+				addElement(false);
+				// see ChemicalElementInterface::setNucleons, the
+				// number is positive if any digit is
+				backIsotope = false;
+				for (size_t k = 0; k < len; k++) {
+					backIsotope |= (str[pos+k] != '0');
+				}
+				lastProperty = NUCLEON_PROPERTY;
+			} else {
+				lastProperty = COEFFICIENT_PROPERTY;
+			}
+			break;
+		case Token::TYPE_FLOAT:
+			if (count == 0 || lastProperty == COEFFICIENT_PROPERTY) {
+				return ERROR_START_WITH_COEF;
+			}
+			lastProperty = COEFFICIENT_PROPERTY;
+			break;
+		default:
+			break;
+	}
+	return ERROR_NONE;
+}
+
+ErrorCode 
+ParserState::CheckFrame::addSubgroup(const CheckFrame& sub)
+{
+	if (sub.count == 0) return ERROR_NONE;
+	if (count > 0 && !backGroup && !backSymbol) {
+		return ERROR_LONE_NUCLEON_NUM;
+	}
+	if (sub.count == 1 && !sub.backGroup && !sub.backSymbol && 
+	    sub.backIsotope)
+	{
+		if (count == 0) return ERROR_LONE_NUCLEON_NUM;
+		backIsotope = true;
+		lastProperty = NUCLEON_PROPERTY;
+	} else {
+		addElement(true);
+		lastProperty = GROUP_PROPERTY;
+	}
+	return ERROR_NONE;
+}
+
+Status 
+ParserState::validate(const char * str, const size_t len)
+{
+	Status s;
+	{
+		StageTimer timer(statistics, Parser::Statistics::STAGE_VALIDATE, 
+		                 stageTiming);
+		s = check(str, len);
+	}
+	CFP_COUNT(statistics.formulas++);
+	CFP_COUNT(statistics.characters += len);
+	if (!s.ok()) {
+		CFP_COUNT(statistics.errors[s.code]++);
+	}
+	countAllocations();
+	return s;
+}
+
+Status 
+ParserState::check(const char * str, const size_t len)
+{
+	mIndex.build(str, len);
+	const size_t end = mIndex.firstInvalid();
+	if (mChecks.empty()) mChecks.resize(1);
+	mChecks[0].clear(0);
+	size_t depth = 0;
+	// the current token, kept in registers
+	Token::Type type = Token::TYPE_NONE;
+	size_t tokPos = 0, tokLen = 0;
+	ErrorCode code = ERROR_NONE;
+	size_t pos = 0;
+	for (; pos < end; pos++)
+	{
+		const CharClass cls = charClass(str[pos]);
+		const Transition& t = transitionTable[type][cls];
+		switch (t.action)
+		{
+			case ACT_APPEND: {
+				size_t n = mIndex.runLength(cls, pos);
+				tokLen += n;
+				pos += n-1;
+				break;
+			}
+			case ACT_APPEND_DECIM:
+				tokLen++;
+				break;
+			case ACT_NEW:
+				code = mChecks[depth].addToken(*this, type, str, tokPos, tokLen);
+				if (code != ERROR_NONE) return tokenError(code, tokPos, tokLen);
+				tokPos = pos;
+				tokLen = 1;
+				break;
+			case ACT_END:
+				code = mChecks[depth].addToken(*this, type, str, tokPos, tokLen);
+				if (code != ERROR_NONE) return tokenError(code, tokPos, tokLen);
+				tokLen = 0;
+				break;
+			case ACT_SKIP:
+				pos += mIndex.runLength(cls, pos)-1;
+				break;
+			case ACT_BRACKET_O:
+				code = mChecks[depth].addToken(*this, type, str, tokPos, tokLen);
+				if (code != ERROR_NONE) return tokenError(code, tokPos, tokLen);
+				if (depth+1 >= maxNestingLevel) {
+					return makeStatus(ERROR_MAX_NESTING, pos, 1);
+				}
+				depth++;
+				if (depth == mChecks.size()) mChecks.push_back(CheckFrame());
+				mChecks[depth].clear(pos);
+				tokLen = 0;
+				break;
+			case ACT_BRACKET_C: {
+				if (depth == 0) {
+					return makeStatus(ERROR_LONE_CLOSING_BRACKET, pos, 1);
+				}
+				code = mChecks[depth].addToken(*this, type, str, tokPos, tokLen);
+				if (code != ERROR_NONE) return tokenError(code, tokPos, tokLen);
+				const size_t open = mChecks[depth].openPos;
+				depth--;
+				if (mChecks[depth].addSubgroup(mChecks[depth+1]) != ERROR_NONE) {
+					// the position before the opening bracket
+					return makeStatus(ERROR_LONE_NUCLEON_NUM, 
+					                  open == 0 ? 0 : open-1, 1);
+				}
+				tokLen = 0;
+				break;
+			}
+			case ACT_ERR_LOWER:
+				return makeStatus(ERROR_SYM_BEG_LOW_CHAR, pos, 1);
+			case ACT_ERR_DECIM:
+				return makeStatus(ERROR_DECIM_BETW_INT, pos, 1);
+			default:
+				return makeStatus(ERROR_INVALID_CHAR, pos, 1);
+		}
+		type = Token::Type(t.type);
+	}
+	if (pos < len) {
+		return makeStatus(ERROR_INVALID_CHAR, pos, 1);
+	}
+	if (depth > 0) {
+		return makeStatus(ERROR_MISSING_CLOSING_BRACKET, 
+		                  mChecks[depth].openPos, 1);
+	}
+	code = mChecks[0].addToken(*this, type, str, tokPos, tokLen);
+	if (code != ERROR_NONE) return tokenError(code, tokPos, tokLen);
+	return makeStatus(ERROR_NONE, 0, 0);
+}
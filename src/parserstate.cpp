@@ -24,53 +24,294 @@
  * Ingo Bressler (libcfp at ingobressler.net)
  */
 
+#include <algorithm>
 #include "parserstate.h"
 
-#define MAX_RECURSION_LVL 30
+/// Default for the maximum nesting level of groups.
+/// Nested groups do not consume stack space, so this is a sanity limit
+/// for the formulas accepted rather than a technical one.
+#define DEFAULT_MAX_NESTING_LVL 30
+
+/// Approximate size of a node of an element tree, the element and the
+/// links of adobe::forest.
+#define TREE_NODE_SIZE (sizeof(CompoundGroupElement) + 4 * sizeof(void *))
 
 using namespace cfp;
 
 ParserState::ParserState()
-	: maxNestingLevel(MAX_RECURSION_LVL),
-	  curNestingLevel(MAX_RECURSION_LVL),
+	: maxNestingLevel(DEFAULT_MAX_NESTING_LVL),
+	  strictSymbols(false),
+	  elementOrder(ORDER_LEXICAL),
+	  empiricalOnly(false),
+	  cache(NULL),
+	  cached(),
+	  diagnostics(NULL),
 	  curPos(0),
-	  formula(),
-	  rootGroup(),
-	  mCurGroup(&rootGroup)
-{}
+	  input(NULL),
+	  inputLen(0),
+	  statistics(),
+	  stageTiming(false),
+	  mFormula(),
+	  mOwnsFormula(true),
+	  mNodePool(),
+	  mPendingStack(),
+	  mFrames(1),
+	  mDepth(0),
+	  mIndex(),
+	  mStatus(),
+	  mChecks(),
+	  mMemoryUsage(0),
+	  mCheckpoints(),
+	  mCheckpointsValid(false),
+	  mCheckpointNesting(0),
+	  mCheckpointStrict(false),
+	  mRecording(false),
+	  mReparsing(false),
+	  mOldCheckpoints(),
+	  mOldNext(0),
+	  mTail(),
+	  mTailFirst(0),
+	  mOldNodes(0),
+	  mOldGrammar(),
+	  mEditEnd(0),
+	  mOldEditEnd(0)
+{
+	input = mFormula.data();
+	rootGroup().setNodePool(&mNodePool);
+	rootGroup().setPendingStack(&mPendingStack);
+	mTail.setNodePool(&mNodePool);
+}
+
+ParserState::ParserState(const ParserState& ps)
+	: maxNestingLevel(ps.maxNestingLevel),
+	  strictSymbols(ps.strictSymbols),
+	  elementOrder(ps.elementOrder),
+	  empiricalOnly(ps.empiricalOnly),
+	  cache(ps.cache),
+	  cached(),
+	  diagnostics(NULL),
+	  curPos(ps.curPos),
+	  input(ps.input),
+	  inputLen(ps.inputLen),
+	  statistics(),
+	  stageTiming(ps.stageTiming),
+	  mFormula(ps.mFormula),
+	  mOwnsFormula(ps.mOwnsFormula),
+	  mNodePool(),
+	  mPendingStack(ps.mPendingStack),
+	  mFrames(ps.mFrames),
+	  mDepth(ps.mDepth),
+	  mIndex(ps.mIndex),
+	  mStatus(ps.mStatus),
+	  mChecks(),
+	  mMemoryUsage(0),
+	  mCheckpoints(),
+	  mCheckpointsValid(false),
+	  mCheckpointNesting(0),
+	  mCheckpointStrict(false),
+	  mRecording(false),
+	  mReparsing(false),
+	  mOldCheckpoints(),
+	  mOldNext(0),
+	  mTail(),
+	  mTailFirst(0),
+	  mOldNodes(0),
+	  mOldGrammar(),
+	  mEditEnd(0),
+	  mOldEditEnd(0)
+{
+	if (mOwnsFormula) input = mFormula.data();
+	mTail.setNodePool(&mNodePool);
+	// the copied groups refer to the pool and stack of ps
+	for (size_t i = 0; i < mFrames.size(); i++) {
+		mFrames[i].group.setNodePool(&mNodePool);
+		mFrames[i].group.setPendingStack(&mPendingStack);
+	}
+	// the counters start at zero, so do the allocations
+	mMemoryUsage = memoryUsage();
+}
 
 void 
-ParserState::reset(const char * f, const size_t l)
+ParserState::clear(void)
 {
-	curNestingLevel = maxNestingLevel;
 	curPos = 0;
-	rootGroup.clear();
-	mCurGroup = &rootGroup;
-	if (f) formula.assign(f, l);
-	else   formula.clear();
+	mDepth = 0;
+	mStatus.code = ERROR_NONE;
+	mStatus.start = 0;
+	mStatus.length = 0;
+	rootGroup().clear();
+	rootGroup().setEmpiricalOnly(empiricalOnly);
+	mPendingStack.clear();
+	token().clear();
+	token().type = Token::TYPE_NONE;
+	mCheckpoints.clear();
+	mCheckpointsValid = false;
 }
 
 void 
-ParserState::setToken(Token & t)
+ParserState::reset(const char * f, const size_t l)
 {
-	mToken = &t;
+	clear();
+	if (f) mFormula.assign(f, l);
+	else   mFormula.clear();
+	mOwnsFormula = true;
+	input = mFormula.data();
+	inputLen = mFormula.length();
+}
+
+void 
+ParserState::resetView(const char * f, const size_t l)
+{
+	clear();
+	mOwnsFormula = false;
+	input = f;
+	inputLen = f ? l : 0;
+}
+
+void 
+ParserState::edit(size_t offset, size_t removed, const char * str, size_t len)
+{
+	ownedFormula();
+	if (offset > mFormula.length()) offset = mFormula.length();
+	if (removed > mFormula.length() - offset) {
+		removed = mFormula.length() - offset;
+	}
+	if (str) mFormula.replace(offset, removed, str, len);
+	else     mFormula.erase(offset, removed);
+	input = mFormula.data();
+	inputLen = mFormula.length();
+}
+
+const std::string&
+ParserState::ownedFormula(void)
+{
+	if (!mOwnsFormula)
+	{
+		mFormula.assign(input, inputLen);
+		mOwnsFormula = true;
+		input = mFormula.data();
+	}
+	return mFormula;
 }
 
 Token & 
 ParserState::token(void)
 {
-	return *mToken;
+	return frame().token;
 }
 
-void 
-ParserState::setCurrentGroup(ElementGroup & eg)
+ElementGroup & 
+ParserState::rootGroup(void)
+{
+	return mFrames.front().group;
+}
+
+const ElementGroup & 
+ParserState::rootGroup(void) const
+{
+	return mFrames.front().group;
+}
+
+ParserState::Frame & 
+ParserState::frame(void)
 {
-	mCurGroup = &eg;
+	return mFrames[mDepth];
 }
 
 ElementGroup & 
 ParserState::currentGroup(void)
 {
-	return *mCurGroup;
+	return frame().group;
+}
+
+void 
+ParserState::pushFrame(void)
+{
+	currentGroup().openSubgroup();
+	mDepth++;
+	CFP_COUNT(statistics.groups++);
+	CFP_COUNT(statistics.maxDepth = std::max(statistics.maxDepth, mDepth));
+	if (mDepth == mFrames.size()) {
+		mFrames.push_back(Frame());
+		mFrames.back().group.setNodePool(&mNodePool);
+		mFrames.back().group.setPendingStack(&mPendingStack);
+	}
+	Frame& f = frame();
+	f.group.clear();
+	f.group.setEmpiricalOnly(empiricalOnly);
+	f.group.setNested(true);
+	f.token.clear();
+	f.token.type = Token::TYPE_NONE;
+	f.openPos = curPos;
+	f.prevPos = (curPos == 0) ? 0 : curPos-1;
+}
+
+void 
+ParserState::popFrame(void)
+{
+	Frame& sub = frame();
+	mDepth--;
+	CFP_COUNT(statistics.tokens[Parser::Statistics::TOKEN_GROUP]++);
+	// adding the result and updating current state
+	currentGroup().addSubgroup(*this, sub.group, sub.prevPos);
+	token().clear();
+}
+
+void 
+ParserState::fail(ErrorCode code, size_t start, size_t length)
+{
+	// each error reported is counted once
+	if (mStatus.code == ERROR_NONE || recovering()) {
+		CFP_COUNT(statistics.errors[code]++);
+	}
+	if (mStatus.code == ERROR_NONE) {
+		// the first error wins, as if it was thrown
+		mStatus.code = code;
+		mStatus.start = start;
+		mStatus.length = length;
+	}
+	if (recovering()) {
+		const Status s = { code, start, length };
+		diagnostics->push_back(s);
+	}
+}
+
+void 
+ParserState::flatten(void)
+{
+	StageTimer timer(statistics, Parser::Statistics::STAGE_FLATTEN, 
+	                 stageTiming);
+	rootGroup().flatten(elementOrder, &statistics);
+}
+
+void 
+ParserState::countAllocations(void)
+{
+#ifndef CFP_NO_STATISTICS
+	const size_t usage = memoryUsage();
+	if (usage > mMemoryUsage) {
+		statistics.allocatedBytes += usage - mMemoryUsage;
+		mMemoryUsage = usage;
+	}
+#endif
+}
+
+size_t 
+ParserState::memoryUsage(void) const
+{
+	size_t nodes = 0;
+	for (size_t i = 0; i < mFrames.size(); i++) {
+		nodes += mFrames[i].group.allocatedNodes();
+	}
+	return mFormula.capacity() + mFrames.size() * sizeof(Frame) + 
+	       mChecks.capacity() * sizeof(CheckFrame) + 
+	       mPendingStack.capacity() * sizeof(ElementGroup::PendingItem) + 
+	       mIndex.memoryUsage() + nodes * TREE_NODE_SIZE;
+}
+
+bool 
+ParserState::failed(void) const
+{
+	return mStatus.code != ERROR_NONE && !recovering();
 }
 
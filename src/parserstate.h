@@ -28,8 +28,12 @@
 #define CFP_PARSERSTATE_H
 
 #include <string>
+#include <deque>
+#include <vector>
 #include "token.h"
 #include "elementgroup.h"
+#include "prescan.h"
+#include "statistics.h"
 
 namespace cfp
 {
@@ -42,55 +46,349 @@ namespace cfp
 	public:
 		ParserState(); //!< Initializes the data required for parsing.
 
+		/// Copy constructor. 
+		/// The copy refers to its own formula if \e ps owns its formula.
+		ParserState(const ParserState& ps);
+
 		/// Prepares for parsing a new formula. Removes all remaining
-		/// data related to the previous formula
+		/// data related to the previous formula. The formula is copied.
 		void 
 		reset(const char * formula, const size_t len);
 
-		/// Continues processing the current formula at this state.
-		/// Is called recursively with updated data pointers.
-		/// \todo Categorization of characters is done by conditional
-		/// tests (if-else). An alternative would be a global, i.e.
-		/// static, lookup table (std::vector or array) containing the
-		/// appropriate handler function pointers for (125-40=85) 
-		/// relevant elements. Performance improvement or overkill ?
-		/// Security issues ?
+		/// Prepares for parsing a new formula without copying it.
+		/// The formula is parsed in place, it has to stay valid until
+		/// parsing is finished.
 		void 
+		resetView(const char * formula, const size_t len);
+
+		/// Returns the formula as string. Creates an owned copy of the
+		/// formula first, if it was set by resetView().
+		const std::string&
+		ownedFormula(void);
+
+		/// Processes the current formula in a single loop.
+		/// Nested groups are kept on an explicit stack of Frame objects
+		/// (see pushFrame(), popFrame()) instead of recursion. The frames
+		/// are reused for subsequent groups and formulas, so the nesting
+		/// depth is limited by maxNestingLevel and available memory only.
+		/// The formula is classified by a StructuralIndex first. Characters
+		/// are categorized by a lookup table ( charClass() ),
+		/// the action for a character is looked up in a static state 
+		/// transition table by its class and the type of the current Token.
+		/// Runs of characters which continue a Token or are ignored are
+		/// processed at once, the index provides their length.
+		/// Errors are reported by fail(), parsing stops at the first one
+		/// unless recovering() (see diagnostics).
+		/// \returns The outcome, ERROR_NONE if the formula is valid. While
+		///          recovering, the first error by position.
+		const Status& 
 		parse(void);
 
-		/// Updates the pointer to the current Token to use.
+		/// Replaces characters of the formula. The formula is owned 
+		/// afterwards, the result is not changed.
+		/// \param[in] offset  Position of the first character to 
+		///                    replace, at most the length of the formula.
+		/// \param[in] removed Number of characters to remove, up to the
+		///                    end of the formula.
+		/// \param[in] str     Characters to insert instead.
+		/// \param[in] len     Number of characters of \e str.
+		void 
+		edit(size_t offset, size_t removed, const char * str, size_t len);
+
+		/// Applies edit() and parses the new formula, reusing the 
+		/// result of the previous reparse() if it was successful and
+		/// the settings are unchanged. In tree mode only, otherwise 
+		/// the same as edit() and parse().
+		///
+		/// During reparse(), a Checkpoint is recorded at the start of
+		/// each top level token. Parsing resumes at the last checkpoint
+		/// before the edit whose token added an element or group, after
+		/// moving the following top level elements aside (see
+		/// ElementGroup::cutTail). It stops at the first checkpoint
+		/// after the edit matching an old one at the same position in
+		/// the unchanged text: the grammar state is the same, so the
+		/// old elements from there on are the result of the remaining
+		/// formula and are moved back (see ElementGroup::appendTail).
+		/// The subtrees of unchanged groups at the top level are kept.
+		/// \returns The same as parse() for the new formula.
+		const Status& 
+		reparse(size_t offset, size_t removed, const char * str, size_t len);
+
+		/// Records an error. Callers return afterwards, parse() stops 
+		/// after the current action. While recovering(), the error is
+		/// appended to diagnostics and parsing goes on.
+		/// \param[in] code   Kind of the error.
+		/// \param[in] start  First position of the erroneous section.
+		/// \param[in] length Length of the erroneous section.
+		void 
+		fail(ErrorCode code, size_t start, size_t length);
+
+		/// Checks the syntax of a formula without building a result.
+		/// Runs the same lexer as parse() but follows the grammar by a
+		/// CheckFrame for each nesting level instead of ElementGroup 
+		/// objects. The formula, result and status of this state are 
+		/// not changed.
+		/// \param[in] str Formula to check, it is not copied.
+		/// \param[in] len Number of characters of \e str.
+		/// \returns The status parse() would return for the formula.
+		Status 
+		validate(const char * str, const size_t len);
+
+		/// Accumulates the result of the root group, see 
+		/// ElementGroup::flatten.
+		void 
+		flatten(void);
+
+		/// Adds the growth of the buffers reused for subsequent 
+		/// formulas since the last call to 
+		/// Parser::Statistics::allocatedBytes.
 		void 
-		setToken(Token & t);
+		countAllocations(void);
+
+		/// Tells if parsing has to stop because of an error. 
+		/// Never true while recovering().
+		bool 
+		failed(void) const;
+
+		/// Tells if all errors are collected, see diagnostics.
+		bool 
+		recovering(void) const { return diagnostics != NULL; }
 
 		/// Returns the current Token used for parsing.
 		Token & 
 		token(void);
 
+		/// Returns the top level result group.
+		ElementGroup &
+		rootGroup(void);
+
+		/// Returns the top level result group.
+		const ElementGroup &
+		rootGroup(void) const;
+
 	private:
-		/// Updates the pointer to the current result group to use.
+		/// State before a top level token, see reparse().
+		struct Checkpoint
+		{
+			size_t pos;   //!< Position of the first character of the token.
+			size_t nodes; //!< Number of top level elements and groups.
+			ElementGroup::GrammarState grammar; //!< State of the top level.
+			unsigned char type; //!< Type of the preceding Token.
+
+			/// Orders checkpoints by position, see reparse().
+			bool 
+			operator<(size_t p) const { return pos < p; }
+		};
+
+		/// Parse data of a single nesting level.
+		struct Frame
+		{
+			ElementGroup group;   //!< Result structure of this level.
+			Token        token;   //!< Token of this level.
+			size_t       openPos; //!< Position of the opening bracket.
+			size_t       prevPos; //!< Position before the opening bracket.
+		};
+
+		/// Grammar state of a nesting level during validate(). Makes the
+		/// decisions of ElementGroup (addToken(), addSubgroup()) based on
+		/// the properties of the last element only.
+		struct CheckFrame
+		{
+			/// Property of the last element set last.
+			typedef enum {
+				SYMBOL_PROPERTY,
+				NUCLEON_PROPERTY,
+				COEFFICIENT_PROPERTY,
+				GROUP_PROPERTY,
+				NO_PROPERTY
+			} Property;
+
+			size_t   count;        //!< Number of elements and groups.
+			bool     backSymbol;   //!< Last element has a symbol.
+			bool     backGroup;    //!< Last element is a group.
+			bool     backIsotope;  //!< Last element has a nucleon number.
+			Property lastProperty; //!< See ElementGroup.
+			size_t   openPos;      //!< Position of the opening bracket.
+
+			/// Starts an empty level opened at \e pos.
+			void 
+			clear(size_t pos);
+
+			/// Appends an element or group.
+			void 
+			addElement(bool isGroup);
+
+			/// Follows ElementGroup::addToken for the token of \e type at
+			/// \e pos with \e len characters of \e str.
+			/// \returns ERROR_NONE or the error, the erroneous section
+			///          is the token unless described otherwise.
+			ErrorCode 
+			addToken(const ParserState& s, Token::Type type, const char * str,
+			         size_t pos, size_t len);
+
+			/// Follows ElementGroup::addSubgroup.
+			/// \returns ERROR_NONE or ERROR_LONE_NUCLEON_NUM.
+			ErrorCode 
+			addSubgroup(const CheckFrame& sub);
+		};
+
+		/// Returns the frame of the current nesting level.
+		Frame &
+		frame(void);
+
+		/// Enters a new nesting level. Reuses a previously allocated
+		/// frame if available.
+		void 
+		pushFrame(void);
+
+		/// Leaves the current nesting level and adds its result group
+		/// to the enclosing level.
+		/// May fail(), see ElementGroup::addSubgroup.
 		void 
-		setCurrentGroup(ElementGroup & eg);
+		popFrame(void);
 
 		/// Returns the current result group used for parsing.
 		ElementGroup &
 		currentGroup(void);
 
-		void parseNumbers(const char& c);  //!< Handles numerical characters.
-		void parseDecimalOp(const char& c);//!< Handles decimal operators.
-		void parseAlpha(const char& c);    //!< Handles Alphabetical characters.
-		void parseBracketO(const char& c); //!< Handles opening parentheses.
-		void parseBracketC(const char& c); //!< Handles closing parentheses.
-		void parseSpace(const char& c);    //!< Handles ignored characters.
+		/// Runs the lexer and the grammar from curPos to the end of the
+		/// formula. Stops at an error unless recovering, or if a 
+		/// checkpoint() matches the previous result.
+		void 
+		scan(void);
+
+		/// Classifies the characters of the formula, see mIndex.
+		void 
+		buildIndex(void);
+
+		/// Records the state before the top level token at curPos 
+		/// during reparse(). Finishes the result if it matches a
+		/// Checkpoint of the previous one behind the edit.
+		/// \returns True, if the result is finished.
+		bool 
+		checkpoint(void);
+
+		/// Tells if the token of an old Checkpoint added an element or
+		/// group, so the element before it was not changed afterwards.
+		/// \param[in] i Index into mOldCheckpoints.
+		bool 
+		addedNode(size_t i) const;
+
+		void parseBracketO(void); //!< Handles opening parentheses, may fail().
+		void parseBracketC(void); //!< Handles closing parentheses, may fail().
+
+		/// Reports an erroneous character. While recovering, the whole 
+		/// run of characters of its class is reported and skipped, the
+		/// current Token is translated and parsing resumes after the 
+		/// run with a new Token.
+		/// \param[in] code Kind of the error.
+		/// \param[in] cls  Class of the character at curPos.
+		void 
+		failChar(ErrorCode code, CharClass cls);
+
+		/// Closes all groups still open at the end of the formula while
+		/// recovering, reporting each opening bracket.
+		void 
+		closeOpenFrames(void);
+
+		/// The checks of validate(), without counting.
+		Status 
+		check(const char * str, const size_t len);
+
+		/// Returns the approximate size of the buffers reused for 
+		/// subsequent formulas, in bytes.
+		size_t 
+		memoryUsage(void) const;
 
 	public:
 		size_t         maxNestingLevel; //!< Maximum nesting level for element groups.
-		size_t         curNestingLevel; //!< Current nesting level during parsing.
+		bool           strictSymbols;   //!< Accept periodic table symbols only.
+		ElementOrder   elementOrder;    //!< Order of the resulting elements.
+		bool           empiricalOnly;   //!< Skip building the element tree.
+		FormulaCache * cache;           //!< Cache of results, may be NULL.
+		std::vector<CompactElement> cached; //!< Result found in cache.
+		/// Receives all errors of the formula if not NULL. Parsing then
+		/// resynchronizes after each error instead of stopping.
+		std::vector<Status> * diagnostics;
 		size_t         curPos;          //!< Current position within the formula.
-		std::string    formula;         //!< Complete formula.
-		ElementGroup   rootGroup;       //!< Hierarchical result structure.
+		const char *   input;           //!< Formula to parse, owned or not.
+		size_t         inputLen;        //!< Number of characters of input.
+		Parser::Statistics statistics;  //!< Counters of the work done.
+		bool           stageTiming;     //!< Measure durations of stages.
 	private:
-		ElementGroup * mCurGroup; //!< Result structure for the current nesting level.
-		Token *        mToken;    //!< Token for the current nesting level.
+		/// Clears the result and the state of the previous formula.
+		void 
+		clear(void);
+
+		std::string    mFormula;        //!< Owned copy of the formula.
+		bool           mOwnsFormula;    //!< True, if input refers to mFormula.
+
+		/// Spare nodes of the element trees of all frames.
+		ElementGroup::NodePool mNodePool;
+
+		/// Items of the groups of the current formula in empirical-only
+		/// mode, shared by all frames.
+		ElementGroup::PendingStack mPendingStack;
+
+		/// Stack of nesting levels, the first one holds the top level
+		/// result. A std::deque keeps references valid while growing.
+		std::deque<Frame> mFrames;
+
+		/// Current nesting level, index into mFrames.
+		size_t            mDepth;
+
+		/// Character classes of the current formula.
+		StructuralIndex   mIndex;
+
+		/// Outcome of parsing the current formula.
+		Status            mStatus;
+
+		/// Nesting levels of validate(), reused for subsequent formulas.
+		std::vector<CheckFrame> mChecks;
+
+		/// Result of memoryUsage() at the last countAllocations().
+		size_t            mMemoryUsage;
+
+		/// Checkpoints of the top level tokens of the current result,
+		/// valid if mCheckpointsValid.
+		std::vector<Checkpoint> mCheckpoints;
+
+		/// True, if mCheckpoints belong to the current successful result
+		/// and the settings below.
+		bool              mCheckpointsValid;
+		size_t            mCheckpointNesting; //!< maxNestingLevel of mCheckpoints.
+		bool              mCheckpointStrict;  //!< strictSymbols of mCheckpoints.
+
+		/// True while checkpoints are recorded, during reparse().
+		bool              mRecording;
+
+		/// True while the result is compared with the previous one.
+		bool              mReparsing;
+
+		/// Checkpoints of the previous result from the resuming one on.
+		std::vector<Checkpoint> mOldCheckpoints;
+
+		/// Next candidate of mOldCheckpoints to match.
+		size_t            mOldNext;
+
+		/// Top level elements of the previous result from the resuming
+		/// checkpoint on.
+		ElementGroup      mTail;
+
+		/// Index of the first element of mTail in the previous result.
+		size_t            mTailFirst;
+
+		/// Number of top level elements of the previous result.
+		size_t            mOldNodes;
+
+		/// Grammar state at the end of the previous result.
+		ElementGroup::GrammarState mOldGrammar;
+
+		/// End of the inserted characters, the text is unchanged behind.
+		size_t            mEditEnd;
+
+		/// End of the removed characters in the previous formula.
+		size_t            mOldEditEnd;
 	};
 } // namespace cfp
 
@@ -0,0 +1,325 @@
+/*
+ * src/prescan.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <cstring>
+#include "prescan.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define CFP_PRESCAN_X86
+#include <immintrin.h>
+#endif
+
+using namespace cfp;
+
+namespace {
+
+/// Number of characters per block.
+const size_t BLOCK_SIZE = 64;
+
+/// Returns the number of trailing zero bits, \e x must not be 0.
+inline unsigned 
+countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#else
+	unsigned n = 0;
+	while (!(x & 1)) { x >>= 1; n++; }
+	return n;
+#endif
+}
+
+/// Classifies a block by table lookup.
+void 
+classifyScalar(const char * p, ClassMasks& m)
+{
+	std::memset(&m, 0, sizeof(m));
+	for(size_t i=0; i < BLOCK_SIZE; i++) {
+		m.cls[charClass(p[i])] |= uint64_t(1) << i;
+	}
+}
+
+#ifdef CFP_PRESCAN_X86
+
+/// Tests for bytes within [lo, hi], for lo > 0 and hi < 128.
+/// Bytes >= 128 are negative in signed comparison and never match.
+inline __m128i 
+inRange16(__m128i v, char lo, char hi)
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo-1)),
+	                     _mm_cmplt_epi8(v, _mm_set1_epi8(hi+1)));
+}
+
+/// Tests for bytes equal to \e c.
+inline __m128i 
+equal16(__m128i v, char c)
+{
+	return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+/// Converts a byte mask to 16 bits at position \e shift.
+inline uint64_t 
+bits16(__m128i v, unsigned shift)
+{
+	return uint64_t(unsigned(_mm_movemask_epi8(v)) & 0xffff) << shift;
+}
+
+/// Classifies a block by SSE2 instructions, 16 characters at a time.
+void 
+classifySse2(const char * p, ClassMasks& m)
+{
+	std::memset(&m, 0, sizeof(m));
+	for(unsigned k=0; k < BLOCK_SIZE; k += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+k));
+		__m128i num = inRange16(v, '0', '9');
+		__m128i dec = _mm_or_si128(equal16(v, ','), equal16(v, '.'));
+		__m128i upp = inRange16(v, 'A', 'Z');
+		__m128i low = inRange16(v, 'a', 'z');
+		__m128i bro = _mm_or_si128(_mm_or_si128(equal16(v, '('), 
+		                                        equal16(v, '[')),
+		                           equal16(v, '{'));
+		__m128i brc = _mm_or_si128(_mm_or_si128(equal16(v, ')'), 
+		                                        equal16(v, ']')),
+		                           equal16(v, '}'));
+		__m128i spc = equal16(v, ' ');
+		m.cls[CHAR_NUM]       |= bits16(num, k);
+		m.cls[CHAR_DECIM]     |= bits16(dec, k);
+		m.cls[CHAR_ALPHA_U]   |= bits16(upp, k);
+		m.cls[CHAR_ALPHA_L]   |= bits16(low, k);
+		m.cls[CHAR_BRACKET_O] |= bits16(bro, k);
+		m.cls[CHAR_BRACKET_C] |= bits16(brc, k);
+		m.cls[CHAR_SPACE]     |= bits16(spc, k);
+	}
+	m.cls[CHAR_INVALID] = ~(m.cls[CHAR_NUM] | m.cls[CHAR_DECIM] |
+	                        m.cls[CHAR_ALPHA_U] | m.cls[CHAR_ALPHA_L] |
+	                        m.cls[CHAR_BRACKET_O] | m.cls[CHAR_BRACKET_C] |
+	                        m.cls[CHAR_SPACE]);
+}
+
+#define CFP_TARGET_AVX2 __attribute__((target("avx2")))
+
+/// Tests for bytes within [lo, hi], see inRange16.
+CFP_TARGET_AVX2 inline __m256i 
+inRange32(__m256i v, char lo, char hi)
+{
+	return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo-1)),
+	                        _mm256_cmpgt_epi8(_mm256_set1_epi8(hi+1), v));
+}
+
+/// Tests for bytes equal to \e c.
+CFP_TARGET_AVX2 inline __m256i 
+equal32(__m256i v, char c)
+{
+	return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+/// Converts a byte mask to 32 bits at position \e shift.
+CFP_TARGET_AVX2 inline uint64_t 
+bits32(__m256i v, unsigned shift)
+{
+	return uint64_t(unsigned(_mm256_movemask_epi8(v))) << shift;
+}
+
+/// Classifies a block by AVX2 instructions, 32 characters at a time.
+CFP_TARGET_AVX2 void 
+classifyAvx2(const char * p, ClassMasks& m)
+{
+	std::memset(&m, 0, sizeof(m));
+	for(unsigned k=0; k < BLOCK_SIZE; k += 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+k));
+		__m256i num = inRange32(v, '0', '9');
+		__m256i dec = _mm256_or_si256(equal32(v, ','), equal32(v, '.'));
+		__m256i upp = inRange32(v, 'A', 'Z');
+		__m256i low = inRange32(v, 'a', 'z');
+		__m256i bro = _mm256_or_si256(_mm256_or_si256(equal32(v, '('), 
+		                                              equal32(v, '[')),
+		                              equal32(v, '{'));
+		__m256i brc = _mm256_or_si256(_mm256_or_si256(equal32(v, ')'), 
+		                                              equal32(v, ']')),
+		                              equal32(v, '}'));
+		__m256i spc = equal32(v, ' ');
+		m.cls[CHAR_NUM]       |= bits32(num, k);
+		m.cls[CHAR_DECIM]     |= bits32(dec, k);
+		m.cls[CHAR_ALPHA_U]   |= bits32(upp, k);
+		m.cls[CHAR_ALPHA_L]   |= bits32(low, k);
+		m.cls[CHAR_BRACKET_O] |= bits32(bro, k);
+		m.cls[CHAR_BRACKET_C] |= bits32(brc, k);
+		m.cls[CHAR_SPACE]     |= bits32(spc, k);
+	}
+	m.cls[CHAR_INVALID] = ~(m.cls[CHAR_NUM] | m.cls[CHAR_DECIM] |
+	                        m.cls[CHAR_ALPHA_U] | m.cls[CHAR_ALPHA_L] |
+	                        m.cls[CHAR_BRACKET_O] | m.cls[CHAR_BRACKET_C] |
+	                        m.cls[CHAR_SPACE]);
+}
+
+#undef CFP_TARGET_AVX2
+
+#endif // CFP_PRESCAN_X86
+
+/// Function type of the block classification implementations.
+typedef void (*ClassifyFunc)(const char * p, ClassMasks& m);
+
+/// Returns the classification function of a supported implementation.
+ClassifyFunc 
+classifyFunc(StructuralIndex::Impl impl)
+{
+	switch(impl)
+	{
+#ifdef CFP_PRESCAN_X86
+		case StructuralIndex::IMPL_AVX2:
+			return &classifyAvx2;
+		case StructuralIndex::IMPL_SSE2:
+			return &classifySse2;
+#endif
+		default:
+			return &classifyScalar;
+	}
+}
+
+} // namespace
+
+StructuralIndex::StructuralIndex()
+	: mBlocks(),
+	  mLength(0)
+{}
+
+bool 
+StructuralIndex::supported(Impl impl)
+{
+	switch(impl)
+	{
+		case IMPL_AUTO:
+		case IMPL_SCALAR:
+			return true;
+#ifdef CFP_PRESCAN_X86
+		case IMPL_SSE2:
+			return true; // part of the compile time target
+		case IMPL_AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+StructuralIndex::Impl 
+StructuralIndex::bestImpl(void)
+{
+	// processor features do not change, test only once
+	static const Impl best = 
+		supported(IMPL_AVX2) ? IMPL_AVX2 :
+		supported(IMPL_SSE2) ? IMPL_SSE2 : IMPL_SCALAR;
+	return best;
+}
+
+void 
+StructuralIndex::build(const char * str, size_t len, Impl impl)
+{
+	if (impl == IMPL_AUTO) impl = bestImpl();
+	else if (!supported(impl)) impl = IMPL_SCALAR;
+	ClassifyFunc classify = classifyFunc(impl);
+
+	mLength = len;
+	mBlocks.resize((len + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	size_t full = len / BLOCK_SIZE;
+	for(size_t b=0; b < full; b++) {
+		classify(str + b*BLOCK_SIZE, mBlocks[b]);
+	}
+	size_t rest = len % BLOCK_SIZE;
+	if (rest > 0)
+	{
+		// pad the last block with (valid) spaces and clear their bits
+		char buf[BLOCK_SIZE];
+		std::memset(buf, ' ', BLOCK_SIZE);
+		std::memcpy(buf, str + full*BLOCK_SIZE, rest);
+		ClassMasks& m = mBlocks[full];
+		classify(buf, m);
+		uint64_t valid = (uint64_t(1) << rest) - 1;
+		for(size_t c=0; c < CHAR_CLASS_COUNT; c++) {
+			m.cls[c] &= valid;
+		}
+	}
+}
+
+size_t 
+StructuralIndex::length(void) const
+{
+	return mLength;
+}
+
+size_t 
+StructuralIndex::blocks(void) const
+{
+	return mBlocks.size();
+}
+
+const ClassMasks& 
+StructuralIndex::block(size_t i) const
+{
+	return mBlocks[i];
+}
+
+size_t 
+StructuralIndex::memoryUsage(void) const
+{
+	return mBlocks.capacity() * sizeof(ClassMasks);
+}
+
+size_t 
+StructuralIndex::firstInvalid(void) const
+{
+	for(size_t b=0; b < mBlocks.size(); b++)
+	{
+		uint64_t inv = mBlocks[b].cls[CHAR_INVALID];
+		if (inv) return b*BLOCK_SIZE + countTrailingZeros(inv);
+	}
+	return mLength;
+}
+
+size_t 
+StructuralIndex::runLength(CharClass c, size_t pos) const
+{
+	size_t   n   = 0;
+	size_t   b   = pos / BLOCK_SIZE;
+	unsigned bit = unsigned(pos % BLOCK_SIZE);
+	while (b < mBlocks.size())
+	{
+		// bits shifted in at the top end the run at the block boundary
+		uint64_t end   = ~(mBlocks[b].cls[c] >> bit);
+		unsigned avail = unsigned(BLOCK_SIZE) - bit;
+		if (end) {
+			unsigned k = countTrailingZeros(end);
+			if (k < avail) return n + k;
+		}
+		n += avail;
+		b++;
+		bit = 0;
+	}
+	return n;
+}
@@ -0,0 +1,119 @@
+/*
+ * src/prescan.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_PRESCAN_H
+#define CFP_PRESCAN_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "charclass.h"
+
+namespace cfp
+{
+	/// Bitmasks of the character classes of 64 adjacent characters.
+	/// Bit \e i of a mask is set, if character \e i of the block belongs
+	/// to the respective class. Bits beyond the end of the formula string 
+	/// are never set.
+	struct ClassMasks
+	{
+		uint64_t cls[CHAR_CLASS_COUNT]; //!< One mask for each CharClass.
+	};
+
+	/// Structural index of a formula string (first stage of parsing).
+	/// Classifies the characters in blocks of 64 before the actual parse.
+	/// On x86 processors SSE2 or AVX2 instructions are used for 16 or 32
+	/// characters at once. The implementation is selected at runtime
+	/// by the features of the processor, a scalar fallback based on 
+	/// charClass() is always available.
+	/// The parser uses the index to process runs of characters of the 
+	/// same class at once ( runLength() ) and to find invalid characters
+	/// without testing each one.
+	class StructuralIndex
+	{
+	public:
+		/// Implementations of the classification.
+		typedef enum
+		{
+			IMPL_AUTO,   //!< Best implementation supported, see bestImpl().
+			IMPL_SCALAR, //!< Table lookup, one character at a time.
+			IMPL_SSE2,   //!< SSE2, 16 characters at a time.
+			IMPL_AVX2    //!< AVX2, 32 characters at a time.
+		} Impl;
+
+		StructuralIndex(); //!< Creates an empty index.
+
+		/// Classifies all characters of a formula string.
+		/// \param[in] str  The formula string.
+		/// \param[in] len  Number of characters in \e str.
+		/// \param[in] impl Implementation to use, falls back to the
+		///                 scalar one if \e impl is not supported.
+		void 
+		build(const char * str, size_t len, Impl impl = IMPL_AUTO);
+
+		/// Returns the fastest implementation supported by the processor.
+		static Impl 
+		bestImpl(void);
+
+		/// Tests if an implementation is supported by the processor and
+		/// was compiled in.
+		static bool 
+		supported(Impl impl);
+
+		/// Returns the number of characters indexed.
+		size_t 
+		length(void) const;
+
+		/// Returns the number of blocks of 64 characters.
+		size_t 
+		blocks(void) const;
+
+		/// Returns the masks of block \e i.
+		const ClassMasks& 
+		block(size_t i) const;
+
+		/// Returns the number of bytes allocated for the masks.
+		size_t 
+		memoryUsage(void) const;
+
+		/// Returns the position of the first invalid character or 
+		/// length() if all characters are valid.
+		size_t 
+		firstInvalid(void) const;
+
+		/// Returns the number of adjacent characters of class \e c 
+		/// starting at \e pos. It is 0 if the character at \e pos is not
+		/// of class \e c.
+		size_t 
+		runLength(CharClass c, size_t pos) const;
+
+	private:
+		std::vector<ClassMasks> mBlocks; //!< Masks of all blocks.
+		size_t                  mLength; //!< Number of characters.
+	};
+} // namespace cfp
+
+#endif // this file
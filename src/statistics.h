@@ -0,0 +1,84 @@
+/*
+ * src/statistics.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_STATISTICS_H
+#define CFP_STATISTICS_H
+
+#include <cfp/cfp.h>
+
+/// Defined to remove the counters of Parser::Statistics from the hot 
+/// paths at compile time, by cmake -DWITH_STATISTICS=OFF. The 
+/// statistics of a Parser stay zero then.
+#ifndef CFP_NO_STATISTICS
+	#include <chrono>
+	#define CFP_COUNT(statement) statement
+#else
+	#define CFP_COUNT(statement)
+#endif
+
+namespace cfp
+{
+	/// Adds the time from its creation to its destruction to a stage of
+	/// Parser::Statistics, if enabled. Does nothing without statistics.
+	/// \sa Parser::setStageTiming
+	class StageTimer
+	{
+	public:
+		/// Starts timing.
+		/// \param[in] stats   Counters to add the duration to.
+		/// \param[in] stage   Stage to add the duration to.
+		/// \param[in] enabled False to skip reading the clock.
+		StageTimer(Parser::Statistics& stats, Parser::Statistics::Stage stage,
+		           bool enabled)
+#ifndef CFP_NO_STATISTICS
+			: mStats(enabled ? &stats : NULL), mStage(stage)
+		{
+			if (mStats) mStart = std::chrono::steady_clock::now();
+		}
+
+		~StageTimer()
+		{
+			if (!mStats) return;
+			const std::chrono::steady_clock::duration d = 
+				std::chrono::steady_clock::now() - mStart;
+			mStats->nanoseconds[mStage] += (uint64_t)
+				std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+		}
+
+	private:
+		StageTimer(const StageTimer&);            //!< Not copyable.
+		StageTimer& operator=(const StageTimer&); //!< Not copyable.
+
+		Parser::Statistics *                  mStats; //!< NULL if disabled.
+		Parser::Statistics::Stage             mStage; //!< Stage to time.
+		std::chrono::steady_clock::time_point mStart; //!< Creation time.
+#else
+		{}
+#endif
+	};
+} // namespace cfp
+
+#endif // this file
@@ -0,0 +1,245 @@
+/*
+ * src/symboltable.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include "symboltable.h"
+
+using namespace cfp;
+
+const unsigned char cfp::periodicIdTable[26][27] = {
+//	  -    a    b    c    d    e    f    g    h    i    j    k    l    m    n    o    p    q    r    s    t    u    v    w    x    y    z
+	{   0,   0,   0,  89,   0,   0,   0,  47,   0,   0,   0,   0,  13,  95,   0,   0,   0,   0,  18,  33,  85,  79,   0,   0,   0,   0,   0 }, // A
+	{   5,  56,   0,   0,   0,   4,   0,   0, 107,  83,   0,  97,   0,   0,   0,   0,   0,   0,  35,   0,   0,   0,   0,   0,   0,   0,   0 }, // B
+	{   6,  20,   0,   0,  48,  58,  98,   0,   0,   0,   0,   0,  17,  96, 112,  27,   0,   0,  24,  55,   0,  29,   0,   0,   0,   0,   0 }, // C
+	{   0,   0, 105,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, 110,   0,   0,   0,   0,   0,  66,   0 }, // D
+	{   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  68,  99,   0,  63,   0,   0,   0,   0,   0 }, // E
+	{   9,   0,   0,   0,   0,  26,   0,   0,   0,   0,   0,   0, 114, 100,   0,   0,   0,   0,  87,   0,   0,   0,   0,   0,   0,   0,   0 }, // F
+	{   0,  31,   0,   0,  64,  32,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // G
+	{   1,   0,   0,   0,   0,   2,  72,  80,   0,   0,   0,   0,   0,   0,   0,  67,   0,   0,   0, 108,   0,   0,   0,   0,   0,   0,   0 }, // H
+	{  53,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  49,   0,   0,   0,  77,   0,   0,   0,   0,   0,   0,   0,   0 }, // I
+	{   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // J
+	{  19,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  36,   0,   0,   0,   0,   0,   0,   0,   0 }, // K
+	{   0,  57,   0,   0,   0,   0,   0,   0,   0,   3,   0,   0,   0,   0,   0,   0,   0,   0, 103,   0,   0,  71, 116,   0,   0,   0,   0 }, // L
+	{   0,   0,   0, 115, 101,   0,   0,  12,   0,   0,   0,   0,   0,   0,  25,  42,   0,   0,   0,   0, 109,   0,   0,   0,   0,   0,   0 }, // M
+	{   7,  11,  41,   0,  60,  10,   0,   0, 113,  28,   0,   0,   0,   0,   0, 102,  93,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // N
+	{   8,   0,   0,   0,   0,   0,   0, 118,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  76,   0,   0,   0,   0,   0,   0,   0 }, // O
+	{  15,  91,  82,   0,  46,   0,   0,   0,   0,   0,   0,   0,   0,  61,   0,  84,   0,   0,  59,   0,  78,  94,   0,   0,   0,   0,   0 }, // P
+	{   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // Q
+	{   0,  88,  37,   0,   0,  75, 104, 111,  45,   0,   0,   0,   0,   0,  86,   0,   0,   0,   0,   0,   0,  44,   0,   0,   0,   0,   0 }, // R
+	{  16,   0,  51,  21,   0,  34,   0, 106,   0,  14,   0,   0,   0,  62,  50,   0,   0,   0,  38,   0,   0,   0,   0,   0,   0,   0,   0 }, // S
+	{   0,  73,  65,  43,   0,  52,   0,   0,  90,  22,   0,   0,  81,  69,   0,   0,   0,   0,   0, 117,   0,   0,   0,   0,   0,   0,   0 }, // T
+	{  92,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // U
+	{  23,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // V
+	{  74,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // W
+	{   0,   0,   0,   0,   0,  54,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // X
+	{  39,   0,  70,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 }, // Y
+	{   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  30,   0,   0,   0,  40,   0,   0,   0,   0,   0,   0,   0,   0 }  // Z
+};
+
+const unsigned char cfp::periodicRankTable[PERIODIC_SYMBOL_COUNT+1] = {
+	  0,  42,  43,  54,  11,   9,  16,  64,  73,  34,  68,  65,  60,   3,  98,
+	 76,  93,  21,   5,  51,  17,  95, 107, 112,  25,  61,  35,  24,  70,  27,
+	117,  39,  41,   6,  96,  15,  52,  86, 101, 115, 118,  66,  62, 104,  92,
+	 90,  79,   2,  18,  49, 100,  94, 105,  48, 114,  26,  10,  53,  19,  82,
+	 67,  80,  99,  33,  40, 103,  30,  46,  31, 109, 116,  56,  44, 102, 113,
+	 87,  75,  50,  83,   8,  45, 108,  78,  13,  81,   7,  91,  38,  85,   1,
+	106,  77, 111,  72,  84,   4,  22,  14,  20,  32,  37,  59,  71,  55,  88,
+	 28,  97,  12,  47,  63,  29,  89,  23,  69,  36,  58,  57, 110,  74
+};
+
+namespace {
+
+/// Symbols of the periodic table in the order of their atomic number.
+const char * const periodicSymbols[PERIODIC_SYMBOL_COUNT] = {
+	"H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne",
+	"Na", "Mg", "Al", "Si", "P", "S", "Cl", "Ar", "K", "Ca",
+	"Sc", "Ti", "V", "Cr", "Mn", "Fe", "Co", "Ni", "Cu", "Zn",
+	"Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr", "Y", "Zr",
+	"Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn",
+	"Sb", "Te", "I", "Xe", "Cs", "Ba", "La", "Ce", "Pr", "Nd",
+	"Pm", "Sm", "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb",
+	"Lu", "Hf", "Ta", "W", "Re", "Os", "Ir", "Pt", "Au", "Hg",
+	"Tl", "Pb", "Bi", "Po", "At", "Rn", "Fr", "Ra", "Ac", "Th",
+	"Pa", "U", "Np", "Pu", "Am", "Cm", "Bk", "Cf", "Es", "Fm",
+	"Md", "No", "Lr", "Rf", "Db", "Sg", "Bh", "Hs", "Mt", "Ds",
+	"Rg", "Cn", "Nh", "Fl", "Mc", "Lv", "Ts", "Og",
+};
+
+} // namespace
+
+SymbolTable&
+SymbolTable::global(void)
+{
+	static SymbolTable table;
+	return table;
+}
+
+SymbolTable::SymbolTable()
+	: mCount(0),
+	  mMoreSymbols(),
+	  mMoreIds(),
+	  mMutex()
+{
+	for (size_t i = 0; i < PERIODIC_SYMBOL_COUNT; i++) {
+		mPeriodic[i+1].assign(periodicSymbols[i]);
+	}
+	for (size_t i = 0; i < SYMBOL_LOCKFREE_CAPACITY; i++) {
+		mSymbols[i].store(0, std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < SYMBOL_HASH_SLOTS; i++) {
+		mSlots[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+SymbolTable::~SymbolTable()
+{
+	for (size_t i = 0; i < SYMBOL_LOCKFREE_CAPACITY; i++) {
+		delete mSymbols[i].load(std::memory_order_relaxed);
+	}
+}
+
+size_t 
+SymbolTable::hash(const char * str, size_t len)
+{
+	size_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)str[i]) * 16777619u;
+	}
+	return h;
+}
+
+SymbolId 
+SymbolTable::find(const char * str, size_t len, size_t h) const
+{
+	// the index is at most half full, there is always an empty slot
+	for (size_t slot = h & (SYMBOL_HASH_SLOTS - 1); ; 
+	     slot = (slot + 1) & (SYMBOL_HASH_SLOTS - 1))
+	{
+		SymbolId i = mSlots[slot].load(std::memory_order_acquire);
+		if (i == 0) return 0;
+		const std::string * s = mSymbols[i - PERIODIC_SYMBOL_COUNT - 1]
+		                        .load(std::memory_order_acquire);
+		if (s->length() == len && s->compare(0, len, str, len) == 0) {
+			return i;
+		}
+	}
+}
+
+SymbolId 
+SymbolTable::id(const char * str, size_t len)
+{
+	if (len == 0) return 0;
+	SymbolId periodic = periodicSymbolId(str, len);
+	if (periodic) return periodic;
+
+	size_t h = hash(str, len);
+	SymbolId i = find(str, len, h);
+	if (i) return i;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	// another thread may have registered it in the meantime
+	i = find(str, len, h);
+	if (i) return i;
+	size_t n = mCount.load(std::memory_order_relaxed);
+	if (n >= SYMBOL_LOCKFREE_CAPACITY) {
+		std::string s(str, len);
+		std::map<std::string, SymbolId>::const_iterator it = mMoreIds.find(s);
+		if (it != mMoreIds.end()) return it->second;
+		i = SymbolId(PERIODIC_SYMBOL_COUNT + 1 + n + mMoreSymbols.size());
+		mMoreSymbols.push_back(s);
+		mMoreIds[s] = i;
+		return i;
+	}
+
+	// publish the symbol before its id becomes visible to find()
+	mSymbols[n].store(new std::string(str, len), std::memory_order_release);
+	i = SymbolId(PERIODIC_SYMBOL_COUNT + 1 + n);
+	size_t slot = h & (SYMBOL_HASH_SLOTS - 1);
+	while (mSlots[slot].load(std::memory_order_relaxed)) {
+		slot = (slot + 1) & (SYMBOL_HASH_SLOTS - 1);
+	}
+	mSlots[slot].store(i, std::memory_order_release);
+	mCount.store(n + 1, std::memory_order_release);
+	return i;
+}
+
+SymbolId 
+SymbolTable::lookup(const char * str, size_t len) const
+{
+	if (len == 0) return 0;
+	SymbolId periodic = periodicSymbolId(str, len);
+	if (periodic) return periodic;
+
+	size_t h = hash(str, len);
+	SymbolId i = find(str, len, h);
+	if (i) return i;
+	if (mCount.load(std::memory_order_acquire) < SYMBOL_LOCKFREE_CAPACITY) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(mMutex);
+	// registered meanwhile or in mMoreIds
+	i = find(str, len, h);
+	if (i) return i;
+	std::map<std::string, SymbolId>::const_iterator it = 
+		mMoreIds.find(std::string(str, len));
+	if (it == mMoreIds.end()) return 0;
+	return it->second;
+}
+
+const std::string& 
+SymbolTable::symbol(SymbolId i) const
+{
+	if (i <= PERIODIC_SYMBOL_COUNT) return mPeriodic[i];
+	i -= PERIODIC_SYMBOL_COUNT + 1;
+	if (i < SYMBOL_LOCKFREE_CAPACITY) {
+		const std::string * s = mSymbols[i].load(std::memory_order_acquire);
+		if (!s) return mPeriodic[0];
+		return *s;
+	}
+	std::lock_guard<std::mutex> lock(mMutex);
+	i -= SYMBOL_LOCKFREE_CAPACITY;
+	if (i >= mMoreSymbols.size()) return mPeriodic[0];
+	return mMoreSymbols[i];
+}
+
+////// ::cfp:: global helper //////
+
+SymbolId 
+cfp::symbolId(const std::string& s)
+{
+	return SymbolTable::global().id(s.data(), s.length());
+}
+
+SymbolId 
+cfp::symbolId(const char * s, size_t len)
+{
+	return SymbolTable::global().id(s, len);
+}
+
+const std::string& 
+cfp::symbolString(SymbolId i)
+{
+	return SymbolTable::global().symbol(i);
+}
@@ -0,0 +1,171 @@
+/*
+ * src/symboltable.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_SYMBOLTABLE_H
+#define CFP_SYMBOLTABLE_H
+
+#include <string>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <cfp/cfp.h>
+
+/// Number of chemical elements in the periodic table.
+#define PERIODIC_SYMBOL_COUNT 118
+
+/// Number of symbols outside the periodic table which are looked up
+/// without locking. Further symbols are kept in a map under a mutex.
+#define SYMBOL_LOCKFREE_CAPACITY 4096
+
+/// Number of slots of the hash index of non-periodic symbols, a power
+/// of two. Twice the capacity keeps the probe sequences short.
+#define SYMBOL_HASH_SLOTS (2*SYMBOL_LOCKFREE_CAPACITY)
+
+namespace cfp
+{
+	/// Ids of the periodic table symbols, indexed by the first character
+	/// (A-Z) and the second character (none, a-z) of a symbol. 
+	/// Each id is the atomic number, 0 marks non-periodic symbols.
+	/// \sa periodicSymbolId
+	extern const unsigned char periodicIdTable[26][27];
+
+	/// Rank of the periodic table symbols in lexical order, indexed by
+	/// their ids. Allows to compare periodic symbols without looking at
+	/// their characters. Index 0 is the empty symbol.
+	extern const unsigned char periodicRankTable[PERIODIC_SYMBOL_COUNT+1];
+
+	/// Perfect hash of the periodic table symbols.
+	/// \param[in] str Characters of the symbol.
+	/// \param[in] len Number of characters in \e str.
+	/// \returns The atomic number of the symbol or 0 for symbols which 
+	///          are not in the periodic table.
+	inline SymbolId 
+	periodicSymbolId(const char * str, size_t len)
+	{
+		if (len < 1 || len > 2) return 0;
+		unsigned int first  = (unsigned char)str[0] - 'A';
+		unsigned int second = (len == 1) ? 0 : (unsigned char)str[1] - 'a' + 1;
+		if (first >= 26 || second >= 27) return 0;
+		return periodicIdTable[first][second];
+	}
+
+	/// Tells if an id belongs to a symbol of the periodic table.
+	inline bool
+	isPeriodicSymbolId(SymbolId id)
+	{
+		return id > 0 && id <= PERIODIC_SYMBOL_COUNT;
+	}
+
+	/// Registry of all element symbols used in the process.
+	/// Maps each symbol to a small integer id and back. The symbols of
+	/// the periodic table are built in, their id is the atomic number.
+	/// Other symbols get the next free id at their first lookup, the ids
+	/// stay valid for the lifetime of the process. Id 0 is the empty 
+	/// symbol.
+	/// The table grows with each distinct symbol, the strict symbol mode
+	/// of the Parser avoids that for untrusted input.
+	/// The table may be used by several threads concurrently. The first
+	/// SYMBOL_LOCKFREE_CAPACITY other symbols are looked up without 
+	/// locking, only registering a new symbol takes the mutex. Further 
+	/// symbols are guarded by the mutex. Registered symbols are never 
+	/// modified or removed.
+	/// \sa symbolId, symbolString
+	class SymbolTable
+	{
+	public:
+		/// Returns the table shared by all parsers.
+		static SymbolTable& 
+		global(void);
+
+		/// Deletes the registered symbols.
+		~SymbolTable();
+
+		/// Returns the id of a symbol, registers unknown symbols.
+		/// \param[in] str Characters of the symbol.
+		/// \param[in] len Number of characters in \e str.
+		SymbolId 
+		id(const char * str, size_t len);
+
+		/// Returns the id of a symbol without registering it.
+		/// \param[in] str Characters of the symbol.
+		/// \param[in] len Number of characters in \e str.
+		/// \returns The id or 0 if the symbol is empty or not registered.
+		SymbolId 
+		lookup(const char * str, size_t len) const;
+
+		/// Returns the symbol of an id, the empty symbol for unknown ids.
+		const std::string& 
+		symbol(SymbolId id) const;
+
+	private:
+		/// Creates a table containing the empty symbol and the symbols of
+		/// the periodic table.
+		SymbolTable();
+
+		/// Looks up a registered non-periodic symbol without locking.
+		/// \param[in] str  Characters of the symbol.
+		/// \param[in] len  Number of characters in \e str.
+		/// \param[in] hash Hash of the symbol, see hash().
+		/// \returns Its id or 0 if it is not registered.
+		SymbolId 
+		find(const char * str, size_t len, size_t hash) const;
+
+		/// FNV-1a hash of the characters of a symbol.
+		static size_t 
+		hash(const char * str, size_t len);
+
+		/// The empty symbol and the symbols of the periodic table, 
+		/// indexed by their ids. Not modified after construction.
+		std::string                     mPeriodic[PERIODIC_SYMBOL_COUNT+1];
+
+		/// The first symbols not in the periodic table, indexed by their
+		/// id minus PERIODIC_SYMBOL_COUNT+1. Each entry is set once 
+		/// before its id is published in mSlots, null entries are unused.
+		std::atomic<const std::string*> mSymbols[SYMBOL_LOCKFREE_CAPACITY];
+
+		/// Open addressing hash index of mSymbols with linear probing.
+		/// Holds the ids, 0 marks empty slots.
+		std::atomic<SymbolId>           mSlots[SYMBOL_HASH_SLOTS];
+
+		/// Number of used entries in mSymbols.
+		std::atomic<size_t>             mCount;
+
+		/// Symbols registered after mSymbols is full, in the order of 
+		/// their ids. A std::deque keeps references to existing symbols
+		/// valid while growing.
+		std::deque<std::string>         mMoreSymbols;
+
+		/// Ids of all symbols in mMoreSymbols.
+		std::map<std::string, SymbolId> mMoreIds;
+
+		/// Serializes registering new symbols, guards mMoreSymbols and
+		/// mMoreIds.
+		mutable std::mutex              mMutex;
+	};
+} // namespace cfp
+
+#endif // this file
@@ -24,51 +24,127 @@
  * Ingo Bressler (libcfp at ingobressler.net)
  */
 
+#include <climits>
 #include <iostream>
 #include <sstream>
+#include <locale>
 #include "token.h"
 
 using namespace cfp;
 
+namespace {
+
+/// Largest exact power of ten of a double.
+const int MAX_EXACT_POW10 = 22;
+
+/// Exact powers of ten, 1e0 to 1e22.
+const double pow10Table[MAX_EXACT_POW10+1] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/// Largest integer up to which all integers are exact doubles (2^53).
+const unsigned long long MAX_EXACT_MANTISSA = 9007199254740992ULL;
+
+/// Tests for a decimal separator.
+inline bool 
+isDecim(char c)
+{
+	return c == '.' || c == ',';
+}
+
+/// Converts a number with more significant digits than a double holds
+/// exactly. Rare, thus not optimized. The classic locale makes the 
+/// conversion independent of the global one.
+double 
+toDoubleSlow(const char * str, size_t len)
+{
+	std::string s(str, len);
+	for(size_t i=0; i < s.length(); i++) {
+		if (isDecim(s[i])) s[i] = '.';
+	}
+	std::istringstream ss(s);
+	ss.imbue(std::locale::classic());
+	double d = 0.0;
+	ss >> d;
+	return d;
+}
+
+} // namespace
+
 Token::Token()
-	: type(TYPE_NONE), mStr()
+	: type(TYPE_NONE), mPos(0), mLength(0)
+{
+}
+
+void Token::start(size_t pos)
+{
+	mPos = pos;
+	mLength = 1;
+}
+
+void Token::extend(size_t n)
 {
+	mLength += n;
 }
 
-void Token::append(char c)
+size_t Token::position() const
 {
-	mStr.append(&c, 1);
+	return mPos;
 }
 
 size_t Token::length() const
 {
-	return mStr.length();
+	return mLength;
 }
 
 void Token::clear()
 {
-	mStr.clear();
+	mLength = 0;
 }
 
-const std::string& Token::toString() const
+std::string Token::toString(const char * formula) const
 {
-	return mStr;
+	return std::string(formula + mPos, mLength);
 }
 
-int Token::toInt() const
+int Token::toInt(const char * formula) const
 {
-	std::stringstream ss(mStr);
-	int i;
-	ss >> i;
-	return i;
+	const char * str = formula + mPos;
+	unsigned long long i = 0;
+	for(size_t k=0; k < mLength; k++)
+	{
+		i = i*10 + (str[k] - '0');
+		if (i > INT_MAX) return INT_MAX;
+	}
+	return int(i);
 }
 
-double Token::toDouble() const
+double Token::toDouble(const char * formula) const
 {
-	std::stringstream ss(mStr);
-	double d;
-	ss >> d;
-	return d;
+	// digits [separator digits], the separator may be the last character
+	const char * str = formula + mPos;
+	unsigned long long mantissa = 0;
+	int  fracDigits = 0;
+	bool fraction = false;
+	for(size_t k=0; k < mLength; k++)
+	{
+		char c = str[k];
+		if (isDecim(c)) {
+			fraction = true;
+			continue;
+		}
+		if (mantissa > (MAX_EXACT_MANTISSA - 9) / 10) {
+			return toDoubleSlow(str, mLength);
+		}
+		mantissa = mantissa*10 + (c - '0');
+		if (fraction) fracDigits++;
+	}
+	if (fracDigits > MAX_EXACT_POW10) {
+		return toDoubleSlow(str, mLength);
+	}
+	// both operands are exact, the division is correctly rounded
+	return double(mantissa) / pow10Table[fracDigits];
 }
 
 std::ostream& std::operator<<(std::ostream& o, const cfp::Token::Type& t)
@@ -95,7 +171,7 @@ std::ostream& std::operator<<(std::ostream& o, const cfp::Token::Type& t)
 
 std::ostream& std::operator<<(std::ostream& o, const cfp::Token& t)
 {
-	o << t.toString() << "(" << t.type << ")";
+	o << "[" << t.position() << "," << t.length() << "](" << t.type << ")";
 	return o;
 }
 
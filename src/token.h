@@ -32,7 +32,8 @@
 namespace cfp
 {
 	/// A group of adjacent characters with a special meaning within a
-	/// formula string.
+	/// formula string. It is a span (position and length) into the 
+	/// formula, the characters are not copied.
 	class Token
 	{
 	public:
@@ -47,13 +48,23 @@ namespace cfp
 			TYPE_NONE    //!< Nothing/Invalid.
 		} Type;
 
-		/// Creates a Token with Token::TYPE_NONE.
+		/// Creates an empty Token with Token::TYPE_NONE.
 		Token();
 
-		/// Appends a single character.
-		/// \param[in] c Character to append.
+		/// Starts the Token at a position, its length is 1 afterwards.
+		/// \param[in] pos Position of the first character in the formula.
 		void 
-		append(char c);
+		start(size_t pos);
+
+		/// Appends the following characters of the formula.
+		/// \param[in] n Number of characters to append.
+		void 
+		extend(size_t n);
+
+		/// Returns the position of the first character.
+		/// \returns Its position in the formula.
+		size_t 
+		position() const;
 
 		/// Returns the length of this Token.
 		/// \returns Its length.
@@ -65,22 +76,30 @@ namespace cfp
 		clear();
 
 		/// Returns the string representation of this Token.
+		/// \param[in] formula The formula this Token refers to.
 		/// \returns A string consisting of all characters.
-		const std::string& 
-		toString() const;
+		std::string 
+		toString(const char * formula) const;
 
 		/// Returns the integer representation of this Token.
+		/// Numbers exceeding the range of int are clamped to INT_MAX.
+		/// \param[in] formula The formula this Token refers to.
 		/// \returns This Token converted to an integer number.
 		int 
-		toInt() const;
+		toInt(const char * formula) const;
 
 		/// Return the floating point representation of this Token.
+		/// Both ',' and '.' are accepted as decimal separator, the
+		/// conversion does not depend on the locale.
+		/// \param[in] formula The formula this Token refers to.
 		/// \returns This Token converted to a floating point number.
-		double toDouble() const;
+		double 
+		toDouble(const char * formula) const;
 
-		Type        type; //!< Its type. \sa Token::Type
+		Type        type;    //!< Its type. \sa Token::Type
 	private:
-		std::string mStr; //!< The characters this token consists of.
+		size_t      mPos;    //!< Position of the first character.
+		size_t      mLength; //!< Number of characters.
 	};
 
 } // namespace cfp
@@ -96,7 +115,7 @@ namespace std
 	std::ostream& operator<<(std::ostream& o, const cfp::Token::Type& t);
 
 	/**
-	 * Writes the string representation of a Token to an output stream.
+	 * Writes the position, length and type of a Token to an output stream.
 	 * \param[in,out] o Output stream to write to.
 	 * \param[in]     t Token to create a string representation from.
 	 * \returns         The output stream o.
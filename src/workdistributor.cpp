@@ -0,0 +1,112 @@
+/*
+ * src/workdistributor.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include "workdistributor.h"
+
+using namespace cfp;
+
+namespace {
+
+/// Packs a range of items into a single integer.
+inline uint64_t 
+pack(uint64_t begin, uint64_t end)
+{
+	return (begin << 32) | end;
+}
+
+/// Returns the first item of a packed range.
+inline uint64_t 
+beginOf(uint64_t r)
+{
+	return r >> 32;
+}
+
+/// Returns the item after the last of a packed range.
+inline uint64_t 
+endOf(uint64_t r)
+{
+	return r & 0xFFFFFFFFu;
+}
+
+} // namespace
+
+WorkDistributor::WorkDistributor(size_t count, size_t workers)
+	: mRanges(workers)
+{
+	for (size_t w = 0; w < workers; w++) {
+		mRanges[w].items.store(pack(count * w / workers, 
+		                            count * (w+1) / workers));
+	}
+}
+
+bool 
+WorkDistributor::takeFront(Range& range, size_t& item)
+{
+	uint64_t r = range.items.load();
+	while (beginOf(r) < endOf(r))
+	{
+		// on failure, r is updated to the current range
+		if (range.items.compare_exchange_weak(
+		            r, pack(beginOf(r) + 1, endOf(r)))) 
+		{
+			item = size_t(beginOf(r));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool 
+WorkDistributor::next(size_t worker, size_t& item)
+{
+	do {
+		if (takeFront(mRanges[worker], item)) return true;
+	} while (steal(worker));
+	return false;
+}
+
+bool 
+WorkDistributor::steal(size_t worker)
+{
+	const size_t n = mRanges.size();
+	for (size_t k = 1; k < n; k++)
+	{
+		Range& victim = mRanges[(worker + k) % n];
+		uint64_t r = victim.items.load();
+		while (beginOf(r) < endOf(r))
+		{
+			uint64_t half = (endOf(r) - beginOf(r) + 1) / 2;
+			uint64_t mid  = endOf(r) - half;
+			if (victim.items.compare_exchange_weak(r, pack(beginOf(r), mid)))
+			{
+				// nobody takes from an empty range, no race here
+				mRanges[worker].items.store(pack(mid, mid + half));
+				return true;
+			}
+		}
+	}
+	return false;
+}
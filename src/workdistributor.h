@@ -0,0 +1,85 @@
+/*
+ * src/workdistributor.h
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#ifndef CFP_WORKDISTRIBUTOR_H
+#define CFP_WORKDISTRIBUTOR_H
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+namespace cfp
+{
+	/// Distributes work items, identified by the indices 0 to count-1, 
+	/// among a fixed number of workers without locking.
+	/// Each worker starts with an equal, contiguous range of items and
+	/// takes them from its front. A worker whose range is exhausted 
+	/// steals the back half of the range of another worker. Thus, workers
+	/// which got short items help out the ones with long items.
+	/// Every item is handed out exactly once.
+	class WorkDistributor
+	{
+	public:
+		/// Splits the items evenly among the workers.
+		/// \param[in] count   Number of work items, less than 2^32.
+		/// \param[in] workers Number of workers, at least 1.
+		WorkDistributor(size_t count, size_t workers);
+
+		/// Returns the next item of a worker. Safe to be called 
+		/// concurrently for different workers.
+		/// \param[in]  worker Index of the calling worker.
+		/// \param[out] item   The item to process.
+		/// \returns False, if all items are handed out.
+		bool 
+		next(size_t worker, size_t& item);
+
+	private:
+		/// Range of items of a worker, padded to its own cache line.
+		/// The begin is stored in the upper, the end in the lower 32 bits,
+		/// so that both are updated by a single atomic operation.
+		struct Range
+		{
+			std::atomic<uint64_t> items; //!< [begin, end) of the items.
+			char pad[64 - sizeof(std::atomic<uint64_t>)]; //!< Padding.
+		};
+
+		/// Takes the first item of a range.
+		/// \returns False, if the range is empty.
+		bool 
+		takeFront(Range& r, size_t& item);
+
+		/// Moves the back half of another worker's range to the empty 
+		/// range of \e worker.
+		/// \returns False, if there was nothing left to steal.
+		bool 
+		steal(size_t worker);
+
+		std::vector<Range> mRanges; //!< Items of each worker.
+	};
+} // namespace cfp
+
+#endif // this file
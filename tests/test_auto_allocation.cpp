@@ -0,0 +1,173 @@
+/*
+ * tests/test_auto_allocation.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <UnitTest++.h>
+#include <cfp/cfp.h>
+
+/// Number of calls of the global operator new, by any thread.
+static std::atomic<size_t> allocationCount(0);
+
+void * 
+operator new(std::size_t size)
+{
+	allocationCount++;
+	void * p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+/// Not inlined, GCC would warn about free() after a builtin operator new.
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void 
+operator delete(void * p) throw()
+{
+	std::free(p);
+}
+
+static const char * steadyFormulas[] = {
+	"H2O", "C6H12O6", "K3(J(4)2(J4(K2.2(F3J))3F2.3))2.5", 
+	"[Fe(CN)6]4 (13C)2H6", "Xy2((CH3)3COH)2.5Mg", NULL
+};
+
+TEST(AllocationSteadyState)
+{
+	for(int empiricalOnly=0; empiricalOnly < 2; empiricalOnly++)
+	{
+		cfp::Parser p;
+		p.setEmpiricalOnly(empiricalOnly == 1);
+		// the memory of the parser grows to the largest formula once
+		for(size_t i=0; steadyFormulas[i]; i++) {
+			p.processView(steadyFormulas[i], strlen(steadyFormulas[i]));
+		}
+		const size_t before = allocationCount;
+		size_t elements = 0;
+		for(size_t round=0; round < 10; round++) {
+			for(size_t i=0; steadyFormulas[i]; i++) {
+				elements += p.processView(steadyFormulas[i], 
+				                          strlen(steadyFormulas[i])).size();
+				elements += p.compactEmpirical().size();
+			}
+		}
+		const size_t allocations = allocationCount - before;
+		CHECK_EQUAL((size_t)0, allocations);
+		CHECK_EQUAL((size_t)10 * 2 * (2+3+4+5+5), elements);
+	}
+}
+
+TEST(AllocationElementContainers)
+{
+	const char * symbols[] = { "Na", "Cl", "C", "H", "O", "N", "Fe", "K" };
+	std::vector<cfp::CompoundElement> v;
+	for(size_t i=0; i < 8; i++) {
+		v.push_back(cfp::CompoundElement());
+		v.back().setSymbol(symbols[i]);
+	}
+	std::vector<cfp::CompoundElement> w(v);
+
+	size_t before = allocationCount;
+	v.reserve(1000); // elements are moved to the new buffer
+	std::sort(v.begin(), v.end());
+	std::reverse(v.begin(), v.end());
+	w = v; // copies into the existing elements
+	cfp::CompoundElement e = std::move(v.back());
+	v.pop_back();
+	const size_t allocations = allocationCount - before;
+	CHECK_EQUAL((size_t)1, allocations); // the buffer only
+	CHECK_EQUAL(0, w.front().symbol().compare("O"));
+	CHECK_EQUAL(0, e.symbol().compare("C"));
+}
+
+TEST(AllocationSteadyStateBatch)
+{
+	cfp::FormulaView formulas[5];
+	for(size_t i=0; i < 5; i++) {
+		formulas[i].str = steadyFormulas[i];
+		formulas[i].len = strlen(steadyFormulas[i]);
+	}
+	cfp::Parser p;
+	cfp::BatchResult r;
+	p.parseBatch(formulas, 5, r);
+	const size_t before = allocationCount;
+	for(size_t round=0; round < 10; round++) {
+		p.parseBatch(formulas, 5, r);
+	}
+	const size_t allocations = allocationCount - before;
+	CHECK_EQUAL((size_t)0, allocations);
+	CHECK_EQUAL((size_t)5, r.size());
+}
+
+TEST(AllocationErrorStatus)
+{
+	const char * invalid[] = {
+		"H$O", "a2O", "H.2O", "3.2H", "H2(3(D4))", "H2)", "SdFeH(", NULL
+	};
+	cfp::Parser p;
+	for(size_t i=0; invalid[i]; i++) {
+		p.tryProcessView(invalid[i], strlen(invalid[i]));
+	}
+	const size_t before = allocationCount;
+	size_t failures = 0;
+	for(size_t round=0; round < 10; round++) {
+		for(size_t i=0; invalid[i]; i++) {
+			failures += !p.tryProcessView(invalid[i], strlen(invalid[i])).ok();
+		}
+	}
+	const size_t allocations = allocationCount - before;
+	CHECK_EQUAL((size_t)0, allocations);
+	CHECK_EQUAL((size_t)10 * 7, failures);
+}
+
+TEST(AllocationValidate)
+{
+	cfp::Parser p;
+	std::string str;
+	for(size_t i=0; i < 1000; i++) str.append("Ca(OH)2 [Fe(CN)6]4 ");
+	// the nesting levels grow to the deepest formula once
+	p.validate(str.c_str(), str.length());
+	for(size_t i=0; steadyFormulas[i]; i++) {
+		p.validate(steadyFormulas[i], strlen(steadyFormulas[i]));
+	}
+	const size_t before = allocationCount;
+	size_t valid = 0;
+	for(size_t round=0; round < 10; round++) {
+		valid += p.validate(str.c_str(), str.length()).ok();
+		for(size_t i=0; steadyFormulas[i]; i++) {
+			valid += p.validate(steadyFormulas[i], 
+			                    strlen(steadyFormulas[i])).ok();
+		}
+	}
+	const size_t allocations = allocationCount - before;
+	CHECK_EQUAL((size_t)0, allocations);
+	CHECK_EQUAL((size_t)10 * 6, valid);
+}
@@ -0,0 +1,225 @@
+/*
+ * tests/test_auto_concurrency.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <UnitTest++.h>
+#include <cfp/cfp.h>
+
+/// Number of threads of the concurrency tests.
+#define THREAD_COUNT 8
+
+/// Work of a single thread: parses formulas with its own Parser and
+/// compares the results to the ones computed in advance.
+struct StressWorker
+{
+	const std::vector<std::string>& formulas; //!< Input.
+	const std::vector<std::string>& expected; //!< Results or errors.
+	size_t id;       //!< Index of this thread.
+	size_t failures; //!< Number of unexpected results.
+
+	StressWorker(const std::vector<std::string>& f, 
+	             const std::vector<std::string>& e, size_t i)
+		: formulas(f), expected(e), id(i), failures(0)
+	{}
+
+	void 
+	run(void)
+	{
+		cfp::Parser p;
+		p.setEmpiricalOnly(id % 2 == 1);
+		for(size_t round=0; round < 20; round++)
+		{
+			// symbols are interned concurrently
+			std::stringstream sym;
+			sym << "Q" << char('a' + id) << char('a' + round);
+			cfp::SymbolId s = cfp::symbolId(sym.str());
+			if (cfp::symbolString(s) != sym.str()) failures++;
+
+			for(size_t i=0; i < formulas.size(); i++)
+			{
+				size_t k = (i + id * 7) % formulas.size();
+				std::stringstream ss;
+				try {
+					ss << p.process(formulas[k].c_str(), formulas[k].length());
+				} catch (cfp::Error& e) {
+					ss << e.code();
+				}
+				if (ss.str() != expected[k]) failures++;
+			}
+		}
+	}
+};
+
+TEST(ConcurrencyIndependentParsers)
+{
+	std::vector<std::string> formulas, expected;
+	const char * strs[] = {
+		"H2O", "K3(J(4)2(J4(K2.2(F3J))3F2.3))2.5", "Xa3 Xb2 Xa(Xc)4",
+		"H2(O", "(13C)2H6 Qz", "a2", "C6H12O6", "[Fe(CN)6]4 K4", NULL
+	};
+	cfp::Parser p;
+	for(size_t i=0; strs[i]; i++) 
+	{
+		formulas.push_back(strs[i]);
+		std::stringstream ss;
+		try {
+			ss << p.process(strs[i], formulas.back().length());
+		} catch (cfp::Error& e) {
+			ss << e.code();
+		}
+		expected.push_back(ss.str());
+	}
+
+	std::vector<StressWorker> workers;
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		workers.push_back(StressWorker(formulas, expected, t));
+	}
+	std::vector<std::thread> threads;
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads.push_back(std::thread(&StressWorker::run, &workers[t]));
+	}
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads[t].join();
+		CHECK_EQUAL((size_t)0, workers[t].failures);
+	}
+}
+
+/// Looks up the same new symbols as the other threads, more than are
+/// looked up without locking.
+void 
+symbolWorker(std::vector<cfp::SymbolId> * ids)
+{
+	for(size_t i=0; i < ids->size(); i++)
+	{
+		std::stringstream sym;
+		sym << "Xs" << i;
+		(*ids)[i] = cfp::symbolId(sym.str());
+	}
+}
+
+TEST(ConcurrencySymbolIds)
+{
+	std::vector<std::vector<cfp::SymbolId> > ids(THREAD_COUNT, 
+		std::vector<cfp::SymbolId>(5000, 0));
+	std::vector<std::thread> threads;
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads.push_back(std::thread(symbolWorker, &ids[t]));
+	}
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads[t].join();
+		CHECK(ids[t] == ids[0]);
+	}
+	for(size_t i=0; i < ids[0].size(); i++)
+	{
+		std::stringstream sym;
+		sym << "Xs" << i;
+		CHECK(ids[0][i] > 118u);
+		CHECK_EQUAL(sym.str(), cfp::symbolString(ids[0][i]));
+	}
+}
+
+TEST(ConcurrencyParallelBatches)
+{
+	std::vector<std::string> strs;
+	for(size_t i=0; i < 4000; i++) 
+	{
+		std::stringstream ss;
+		ss << "Yq" << i % 37 << " C" << i % 11 << "(13C)H" << i;
+		if (i % 17 == 0) ss << ")";
+		strs.push_back(ss.str());
+	}
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; i < strs.size(); i++) {
+		cfp::FormulaView f = { strs[i].c_str(), strs[i].length() };
+		formulas.push_back(f);
+	}
+	const cfp::Parser p;
+	cfp::BatchResult expected, r1, r2;
+	cfp::Parser(p).parseBatch(&formulas[0], formulas.size(), expected);
+	// two parallel batches at the same time, sharing the settings
+	std::thread other(&cfp::Parser::parseBatchParallel, &p, 
+	                  &formulas[0], formulas.size(), std::ref(r1), 4);
+	p.parseBatchParallel(&formulas[0], formulas.size(), r2, 4);
+	other.join();
+	CHECK(expected.status == r1.status);
+	CHECK(expected.symbols == r1.symbols);
+	CHECK(expected.coefficients == r1.coefficients);
+	CHECK(expected.status == r2.status);
+	CHECK(expected.symbols == r2.symbols);
+	CHECK(expected.coefficients == r2.coefficients);
+}
+
+/// Parses formulas with its own Parser and a shared cache.
+void 
+cachedWorker(cfp::FormulaCache * cache, const std::vector<std::string> * strs,
+             const std::vector<std::string> * expected, size_t * failures)
+{
+	cfp::Parser p;
+	p.setEmpiricalOnly(true);
+	p.setCache(cache);
+	for(size_t round=0; round < 10; round++)
+	{
+		for(size_t i=0; i < strs->size(); i++)
+		{
+			std::stringstream ss;
+			ss << p.process((*strs)[i].c_str(), (*strs)[i].length());
+			if (ss.str() != (*expected)[i]) (*failures)++;
+		}
+	}
+}
+
+TEST(ConcurrencySharedCache)
+{
+	std::vector<std::string> strs, expected;
+	cfp::Parser p;
+	for(size_t i=0; i < 200; i++) 
+	{
+		std::stringstream ss;
+		ss << "C" << i % 17 + 1 << "H" << i << "Zq" << i % 3;
+		strs.push_back(ss.str());
+		std::stringstream res;
+		res << p.process(strs.back().c_str(), strs.back().length());
+		expected.push_back(res.str());
+	}
+	// smaller than the number of formulas, entries are replaced
+	cfp::FormulaCache cache(64);
+	std::vector<size_t> failures(THREAD_COUNT, 0);
+	std::vector<std::thread> threads;
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads.push_back(std::thread(cachedWorker, &cache, &strs, 
+		                              &expected, &failures[t]));
+	}
+	for(size_t t=0; t < THREAD_COUNT; t++) {
+		threads[t].join();
+		CHECK_EQUAL((size_t)0, failures[t]);
+	}
+	cfp::FormulaCache::Statistics stats = cache.statistics();
+	CHECK_EQUAL((size_t)THREAD_COUNT * 10 * 200, stats.hits + stats.misses);
+	CHECK(stats.size <= 64);
+}
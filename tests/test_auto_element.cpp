@@ -24,6 +24,7 @@
  * Ingo Bressler (libcfp at ingobressler.net)
  */
 
+#include <utility>
 #include <UnitTest++.h>
 #include <cfp/cfp.h>
 
@@ -59,6 +60,47 @@ TEST(ElementGetterSetterCopyConstructor)
 	CHECK_ELEMENT_VALUES(g);
 }
 
+TEST(ElementAssignmentMoveSwap)
+{
+	cfp::CompoundElement e;
+	e.setCoefficient(5.5);
+	e.setSymbol("foo");
+	e.setNucleons(3);
+
+	cfp::CompoundElement g;
+	g = e; // copies the data, not the implementation pointer
+	CHECK_ELEMENT_VALUES(g);
+	e.setSymbol("bar");
+	CHECK_ELEMENT_VALUES(g);
+	g = g;
+	CHECK_ELEMENT_VALUES(g);
+
+	cfp::CompoundElement m(std::move(g));
+	CHECK_ELEMENT_VALUES(m);
+	g = m; // moved-from elements may be assigned to
+	CHECK_ELEMENT_VALUES(g);
+
+	cfp::CompoundElement h;
+	h = std::move(m);
+	CHECK_ELEMENT_VALUES(h);
+	cfp::swap(e, h);
+	CHECK_ELEMENT_VALUES(e);
+	CHECK_EQUAL(0, h.symbol().compare("bar"));
+
+	cfp::ChemicalElement c1, c2;
+	c1.setSymbol("Ab");
+	c1.setNucleons(7);
+	c2 = c1;
+	c1.setSymbol("Cd");
+	CHECK_EQUAL(0, c2.symbol().compare("Ab"));
+	CHECK_EQUAL(7, c2.nucleons());
+	cfp::ChemicalElement c3(std::move(c2));
+	CHECK_EQUAL(0, c3.symbol().compare("Ab"));
+	c1.swap(c3);
+	CHECK_EQUAL(0, c1.symbol().compare("Ab"));
+	CHECK_EQUAL(0, c3.symbol().compare("Cd"));
+}
+
 TEST(ElementComparison)
 {
 	cfp::CompoundElement e1;
@@ -78,3 +120,58 @@ TEST(ElementComparison)
 	CHECK(e1 < e2);
 }
 
+TEST(ElementCompact)
+{
+	CHECK_EQUAL(16u, sizeof(cfp::CompactElement));
+
+	cfp::CompactElement e;
+	CHECK_EQUAL(1.0, e.coefficient());
+	CHECK(!e.isIsotope());
+	CHECK(e.symbol().empty());
+	CHECK_EQUAL(0u, e.symbolId());
+
+	e.setCoefficient(5.5);
+	e.setSymbol("foo");
+	e.setNucleons(3);
+	CHECK_ELEMENT_VALUES(e);
+	CHECK_EQUAL(cfp::symbolId("foo"), e.symbolId());
+
+	cfp::CompoundElement c(e);
+	CHECK_ELEMENT_VALUES(c);
+	cfp::CompactElement g(c);
+	CHECK_ELEMENT_VALUES(g);
+	CHECK_EQUAL(0, g.toString().compare(c.toString()));
+	CHECK_EQUAL(0, g.toString().compare("(3foo)5.5"));
+
+	// comparison is lexical, independent of registration order
+	cfp::CompactElement b(cfp::symbolId("Bb"), 0, 1.0);
+	cfp::CompactElement a(cfp::symbolId("Aa"), 2, 1.0);
+	CHECK(a < b);
+	CHECK(!(b < a));
+	b.setSymbolId(a.symbolId());
+	CHECK(b < a);
+}
+
+TEST(ElementSymbolTable)
+{
+	CHECK_EQUAL(0u, cfp::symbolId(""));
+	CHECK_EQUAL(1u, cfp::symbolId("H"));
+	CHECK_EQUAL(26u, cfp::symbolId("Fe"));
+	CHECK_EQUAL(118u, cfp::symbolId("Og"));
+	CHECK_EQUAL(0, cfp::symbolString(92).compare("U"));
+	CHECK(cfp::symbolString(100000).empty());
+
+	cfp::SymbolId d = cfp::symbolId("D");
+	CHECK(d > 118u);
+	CHECK_EQUAL(d, cfp::symbolId("D"));
+	CHECK_EQUAL(0, cfp::symbolString(d).compare("D"));
+
+	// lexical order of compact elements, periodic and interned symbols
+	for (cfp::SymbolId i = 1; i <= d; i++) {
+		for (cfp::SymbolId k = 1; k <= d; k++) {
+			if (k > 118u && k < d) continue;
+			cfp::CompactElement a(i, 0, 1.0), b(k, 0, 1.0);
+			CHECK_EQUAL(cfp::symbolString(i) < cfp::symbolString(k), a < b);
+		}
+	}
+}
@@ -26,6 +26,7 @@
 
 #include <iostream>
 #include <vector>
+#include <cstring>
 #include <UnitTest++.h>
 #include <cfp/cfp.h>
 
@@ -195,3 +196,158 @@ TEST(ErrorMissingClosingBracket)
 	                   cfp::ErrorMissingClosingBracket, (size_t)2, (size_t)1);
 }
 
+TEST(ErrorUnknownSymbol)
+{
+	cfp::Parser p; std::string str;
+	str.assign("D2O");
+	p.process(str.c_str(), str.length()); // accepted by default
+	p.setStrictSymbols(true);
+	CHECK(p.strictSymbols());
+	CHECK_THROW_CUSTOM(p.process(str.c_str(), str.length()), 
+	                   cfp::ErrorUnknownSymbol, (size_t)0, (size_t)1);
+	str.assign("H2(SO4)3 Og Xy");
+	CHECK_THROW_CUSTOM(p.process(str.c_str(), str.length()), 
+	                   cfp::ErrorUnknownSymbol, (size_t)12, (size_t)2);
+	str.assign("Ca(OH)2 Uue");
+	CHECK_THROW_CUSTOM(p.process(str.c_str(), str.length()), 
+	                   cfp::ErrorUnknownSymbol, (size_t)8, (size_t)3);
+}
+
+TEST(ErrorFileAccess)
+{
+	cfp::Parser p;
+	cfp::BatchResult r;
+	CHECK_THROW_CUSTOM(p.parseFile("does/not/exist.txt", r), 
+	                   cfp::ErrorFileAccess, (size_t)0, (size_t)0);
+}
+
+TEST(ErrorStatus)
+{
+	const char * formulas[] = {
+		"H2O", "H$O", "a2O", "H.2O", "3.2H", "H2(3(D4))", "H2)", 
+		"SdFeH(", "N((((H2O))))", "H2(SO4)3 Og Xy", NULL
+	};
+	cfp::Parser p;
+	p.setStrictSymbols(true);
+	p.setMaxNestingLevel(3);
+	for(size_t i=0; formulas[i]; i++)
+	{
+		const size_t len = strlen(formulas[i]);
+		cfp::Status s = p.tryProcess(formulas[i], len);
+		cfp::ErrorCode code = cfp::ERROR_NONE;
+		size_t start = 0, length = 0;
+		std::string message;
+		try { p.process(formulas[i], len);
+		} catch (cfp::Error& e) {
+			code = e.code();
+			message = e.what(start, length);
+		}
+		CHECK_EQUAL(code, s.code);
+		CHECK_EQUAL(start, s.start);
+		CHECK_EQUAL(length, s.length);
+		CHECK_EQUAL(message, std::string(s.message()));
+		CHECK_EQUAL(i > 0, !s.ok());
+	}
+	// the status variant of a parse error is thrown as it
+	cfp::Status s = p.tryProcessView("H2)", 3);
+	CHECK_THROW_CUSTOM(cfp::throwError(s), 
+	                   cfp::ErrorLoneClosingBracket, (size_t)2, (size_t)1);
+	CHECK(p.tryProcessView("H2O", 3).ok());
+	CHECK_EQUAL((size_t)2, p.empirical().size());
+}
+
+TEST(ErrorStatusFileAccess)
+{
+	cfp::Parser p;
+	cfp::BatchResult r;
+	struct Sink: public cfp::BatchSink {
+		void consume(size_t, const cfp::FormulaView *, 
+		             const cfp::FormulaView *, const cfp::BatchResult&) {}
+	} sink;
+	cfp::Status s = p.tryParseFile("does/not/exist.txt", sink);
+	CHECK_EQUAL(cfp::ERROR_FILE_ACCESS, s.code);
+	CHECK_EQUAL(std::string("Unable to read the formula file !"), 
+	            std::string(s.message()));
+}
+
+TEST(ErrorDiagnostics)
+{
+	cfp::Parser p;
+	p.setStrictSymbols(true);
+	p.setMaxNestingLevel(3);
+	// formulas with a single error report the same as tryProcess
+	const char * single[] = {
+		"H$O", "a2O", "H.2O", "3.2H", "H2)", "FeH(", "N((((H2O))))", 
+		"H2(SO4)3 Xy", NULL
+	};
+	std::vector<cfp::Status> d;
+	for(size_t i=0; single[i]; i++)
+	{
+		const size_t len = strlen(single[i]);
+		d.clear();
+		CHECK_EQUAL((size_t)1, p.diagnoseView(single[i], len, d));
+		cfp::Status s = p.tryProcessView(single[i], len);
+		CHECK_EQUAL(s.code, d.at(0).code);
+		CHECK_EQUAL(s.start, d.at(0).start);
+		CHECK_EQUAL(s.length, d.at(0).length);
+	}
+	// all errors, in one pass
+	std::string str("xH2(3)Zz)) $$((");
+	d.clear();
+	CHECK_EQUAL((size_t)7, p.diagnoseView(str.c_str(), str.length(), d));
+	const cfp::ErrorCode codes[] = {
+		cfp::ERROR_SYM_BEG_LOW_CHAR, cfp::ERROR_UNKNOWN_SYMBOL, 
+		cfp::ERROR_LONE_CLOSING_BRACKET, cfp::ERROR_LONE_CLOSING_BRACKET,
+		cfp::ERROR_INVALID_CHAR, cfp::ERROR_MISSING_CLOSING_BRACKET, 
+		cfp::ERROR_MISSING_CLOSING_BRACKET
+	};
+	const size_t starts[]  = { 0, 6, 8, 9, 11, 13, 14 };
+	const size_t lengths[] = { 1, 2, 1, 1,  2,  1,  1 };
+	for(size_t i=0; i < d.size(); i++) {
+		CHECK_EQUAL(codes[i], d[i].code);
+		CHECK_EQUAL(starts[i], d[i].start);
+		CHECK_EQUAL(lengths[i], d[i].length);
+	}
+	// a lone nucleon number is found at the end of its group, reported
+	// in the order of the positions
+	str.assign("H2(3(Dd4))");
+	d.clear();
+	CHECK_EQUAL((size_t)2, p.diagnoseView(str.c_str(), str.length(), d));
+	CHECK_EQUAL(cfp::ERROR_LONE_NUCLEON_NUM, d.at(0).code);
+	CHECK_EQUAL(cfp::ERROR_UNKNOWN_SYMBOL, d.at(1).code);
+	CHECK(d.at(0).start < d.at(1).start);
+	// valid formulas have a result
+	d.clear();
+	CHECK_EQUAL((size_t)0, p.diagnoseView("H2O", 3, d));
+	CHECK_EQUAL((size_t)2, p.empirical().size());
+}
+
+TEST(ErrorDiagnosticsBatch)
+{
+	const char * formulas[] = { "H2O", "a$b)", "", "(C6H6", NULL };
+	std::vector<cfp::FormulaView> views;
+	for(size_t i=0; formulas[i]; i++) {
+		cfp::FormulaView v = { formulas[i], strlen(formulas[i]) };
+		views.push_back(v);
+	}
+	cfp::Parser p;
+	cfp::BatchDiagnostics r;
+	p.diagnoseBatch(&views[0], views.size(), r);
+	CHECK_EQUAL(views.size(), r.size());
+	CHECK_EQUAL(r.diagnostics.size(), r.offsets.back());
+	CHECK(p.formula().empty());
+	for(size_t i=0; i < views.size(); i++)
+	{
+		std::vector<cfp::Status> d;
+		p.diagnoseView(views[i].str, views[i].len, d);
+		CHECK_EQUAL(d.size(), r.offsets[i+1] - r.offsets[i]);
+		for(size_t k=0; k < d.size() && k < r.offsets[i+1] - r.offsets[i]; k++)
+		{
+			const cfp::Status& s = r.diagnostics[r.offsets[i] + k];
+			CHECK_EQUAL(d[k].code, s.code);
+			CHECK_EQUAL(d[k].start, s.start);
+		}
+	}
+	CHECK_EQUAL((size_t)4, r.offsets[2] - r.offsets[1]);
+	CHECK_EQUAL((size_t)1, r.offsets[4] - r.offsets[3]);
+}
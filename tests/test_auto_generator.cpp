@@ -0,0 +1,146 @@
+/*
+ * tests/test_auto_generator.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <string>
+#include <vector>
+#include <UnitTest++.h>
+#include <cfp/cfp.h>
+#include <cfp/generator.h>
+
+using namespace cfp;
+
+/// Number of formulas generated by each test.
+#define GENERATOR_COUNT 2000
+
+TEST(GeneratorDeterministic)
+{
+	FormulaGenerator::Settings s;
+	s.malformedFraction = 0.2;
+	FormulaGenerator g1(42, s), g2(42, s), g3(43, s);
+	std::string f1, f2, f3;
+	size_t differing = 0;
+	for(int i=0; i < GENERATOR_COUNT; i++) {
+		CHECK_EQUAL(g1.next(f1), g2.next(f2));
+		CHECK_EQUAL(f1, f2);
+		g3.next(f3);
+		if (f1 != f3) differing++;
+	}
+	CHECK(differing > GENERATOR_COUNT / 2);
+
+	// restarting reproduces the sequence
+	g1.setSeed(42);
+	g2.setSeed(42);
+	for(int i=0; i < 10; i++) {
+		g1.next(f1);
+		g2.next(f2);
+		CHECK_EQUAL(f1, f2);
+	}
+
+	// independent of the platform
+	FormulaGenerator g4(1);
+	g4.next(f1);
+	CHECK_EQUAL("OH17P5C(62)C15CClH10O17 [H18C2O([54H]15(H4HC8H7)13H14)]15", 
+	            f1);
+}
+
+TEST(GeneratorGrammar)
+{
+	FormulaGenerator::Settings s;
+	s.minLength = 1;
+	s.maxLength = 200;
+	s.groupProbability = 0.3;
+	s.isotopeProbability = 0.3;
+	s.decimalProbability = 0.3;
+	s.spaceProbability = 0.3;
+	s.malformedFraction = 0.25;
+	Parser p;
+	p.setStrictSymbols(true);
+	p.setMaxNestingLevel(s.maxDepth + 1);
+	const FormulaGenerator::IsotopeNotation notations[] = {
+		FormulaGenerator::ISOTOPE_PREFIX, 
+		FormulaGenerator::ISOTOPE_SUFFIX, 
+		FormulaGenerator::ISOTOPE_MIXED
+	};
+	for(int n=0; n < 3; n++) {
+		s.isotopeNotation = notations[n];
+		FormulaGenerator g(n, s);
+		std::string f;
+		size_t malformed = 0;
+		for(int i=0; i < GENERATOR_COUNT; i++) {
+			const bool bad = g.next(f);
+			if (bad) malformed++;
+			CHECK(f.size() >= s.minLength);
+			Status st = p.tryProcess(f.data(), f.size());
+			CHECK_EQUAL(bad, !st.ok());
+		}
+		// 500 expected, 4 standard deviations
+		CHECK(malformed > 420 && malformed < 580);
+	}
+}
+
+TEST(GeneratorDeepNesting)
+{
+	FormulaGenerator::Settings s;
+	s.maxDepth = 30;
+	s.groupProbability = 1.0;
+	s.maxGroupItems = 2;
+	s.minLength = 1000;
+	s.maxLength = 1000;
+	FormulaGenerator g(7, s);
+	std::string f;
+	g.next(f);
+	CHECK(f.size() >= s.minLength);
+	// the first item is a chain of groups
+	CHECK_EQUAL((size_t)30, f.find_first_not_of("([{"));
+
+	Parser p;
+	p.setStrictSymbols(true);
+	p.setMaxNestingLevel(31);
+	CHECK(p.validate(f.data(), f.size()).ok());
+	p.setMaxNestingLevel(30);
+	CHECK_EQUAL(ERROR_MAX_NESTING, p.validate(f.data(), f.size()).code);
+}
+
+TEST(GeneratorElements)
+{
+	FormulaGenerator::Settings s;
+	s.symbols.clear();
+	s.symbols.push_back("Fe");
+	s.symbols.push_back("Cu");
+	s.weights.clear();
+	s.weights.push_back(1.0);
+	s.weights.push_back(0.0);
+	s.groupProbability = 0.0;
+	s.isotopeProbability = 0.0;
+	s.countProbability = 0.0;
+	s.spaceProbability = 0.0;
+	s.minLength = 8;
+	s.maxLength = 8;
+	FormulaGenerator g(3, s);
+	std::string f;
+	CHECK(!g.next(f));
+	CHECK_EQUAL("FeFeFeFe", f);
+}
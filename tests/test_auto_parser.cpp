@@ -26,8 +26,17 @@
 
 #include <iostream>
 #include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 #include <UnitTest++.h>
 #include <cfp/cfp.h>
+#include <cfp/generator.h>
+#include "prescan.h"
 
 TEST(ParserConstructor)
 {
@@ -63,6 +72,27 @@ TEST(ParserGetterSetterCopyConstructor)
 	CHECK(p1.empirical().empty());
 }
 
+TEST(ParserFormulaView)
+{
+	cfp::Parser p;
+	char buf[] = "H2O";
+	p.setFormulaView(buf, 3);
+	p.process();
+	CHECK_EQUAL((size_t)2, p.empirical().size());
+	// the buffer is not copied by processing
+	p.processView(buf, 2);
+	buf[0] = 'N';
+	std::stringstream ss;
+	ss << p.empirical();
+	CHECK_EQUAL(0, ss.str().compare("H2"));
+	// copied on demand
+	CHECK_EQUAL(0, p.formula().compare("N2"));
+	buf[0] = 'K';
+	CHECK_EQUAL(0, p.formula().compare("N2"));
+	cfp::Parser p1(p);
+	CHECK_EQUAL(0, p1.formula().compare("N2"));
+}
+
 #define TEST_FORMULA_1 "K3 (4J)2.3 (13C)1.2"
 TEST(ParserProcessingRegular1)
 {
@@ -118,10 +148,24 @@ TEST(ParserProcessingRegular5)
 	CHECK_EQUAL(0, ss.str().compare("H7 (1H)5"));
 }
 
-/* internal datastructures (std::map) don't preserve order (sort lexically instead)
+TEST(ParserProcessingNumbers)
+{
+	cfp::Parser p;
+	CHECK_EQUAL(0.1, p.process("H0.1", 4).front().coefficient());
+	CHECK_EQUAL(12.5, p.process("H12,5", 5).front().coefficient());
+	CHECK_EQUAL(3.0, p.process("H3.", 3).front().coefficient());
+	CHECK_EQUAL(1.0/3.0, 
+	            p.process("H0.333333333333333314829616256247", 33).front().coefficient());
+	CHECK_EQUAL(123456789.0, p.process("H123456789", 10).front().coefficient());
+	CHECK_EQUAL(13, p.process("13C", 3).front().nucleons());
+	CHECK_EQUAL(2147483647, p.process("99999999999C", 12).front().nucleons());
+}
+
 TEST(ParserProcessingLoop)
 {
 	cfp::Parser p(TEST_FORMULA_1, sizeof(TEST_FORMULA_1)-1);
+	CHECK_EQUAL(cfp::ORDER_LEXICAL, p.elementOrder());
+	p.setElementOrder(cfp::ORDER_APPEARANCE);
 	p.process();
 
 	CHECK_EQUAL((size_t)3, p.empirical().size());
@@ -129,7 +173,36 @@ TEST(ParserProcessingLoop)
 	ss3 << p.empirical();
 	CHECK_EQUAL(0, ss3.str().compare(TEST_FORMULA_1));
 }
-*/
+
+TEST(ParserProcessingHillOrder)
+{
+	cfp::Parser p;
+	p.setElementOrder(cfp::ORDER_HILL);
+	std::stringstream ss1, ss2, ss3;
+	ss1 << p.process("NaCl(H2O)2", 10);
+	CHECK_EQUAL(0, ss1.str().compare("Cl H4 Na O2"));
+	ss2 << p.process("OC(13C)H3(CH2)2Br", 17);
+	CHECK_EQUAL(0, ss2.str().compare("C3 (13C) H7 Br O"));
+	ss3 << p.process("B(2H)H6", 7);
+	CHECK_EQUAL(0, ss3.str().compare("B H6 (2H)"));
+}
+
+TEST(ParserProcessingManyElements)
+{
+	cfp::Parser p;
+	p.setElementOrder(cfp::ORDER_APPEARANCE);
+	std::stringstream in, out;
+	for(int i=1; i <= 100; i++) in << "(" << i << "H)";
+	for(int i=1; i <= 100; i++) in << "(" << i << "H)" << i;
+	p.process(in.str().c_str(), in.str().length());
+	CHECK_EQUAL((size_t)100, p.empirical().size());
+	cfp::Compound::const_iterator it = p.empirical().begin();
+	for(int i=1; i <= 100 && it != p.empirical().end(); i++, it++)
+	{
+		CHECK_EQUAL(i, it->nucleons());
+		CHECK_EQUAL(i+1.0, it->coefficient());
+	}
+}
 
 TEST(ParserProcessingComplex)
 {
@@ -142,3 +215,868 @@ TEST(ParserProcessingComplex)
 	CHECK_EQUAL(0, p.toMarkup().compare("K<sub>3</sub>(<sup>4</sup>J<sub>2</sub>(J<sub>4</sub>(K<sub>2.2</sub>(F<sub>3</sub>J))<sub>3</sub>F<sub>2.3</sub>))<sub>2.5</sub>"));
 }
 
+/// Processes a formula and returns the result or the error message 
+/// and position.
+static std::string
+processOrError(cfp::Parser& p, const char * formula)
+{
+	std::stringstream ss;
+	try {
+		ss << p.process(formula, strlen(formula));
+	} catch (cfp::Error& e) {
+		size_t start, len;
+		ss << e.what(start, len) << " " << start << " " << len;
+	}
+	return ss.str();
+}
+
+/// Writes the symbol, nucleons and coefficient of each element, the
+/// coefficients with all digits to compare them exactly.
+static std::string
+exactString(const cfp::Compound& c)
+{
+	std::stringstream ss;
+	ss << std::setprecision(17);
+	for(cfp::Compound::const_iterator it = c.begin(); it != c.end(); it++) {
+		ss << it->symbol() << " " << it->nucleons() << " " 
+		   << it->coefficient() << " ";
+	}
+	return ss.str();
+}
+
+TEST(ParserEmpiricalOnly)
+{
+	const char * formulas[] = {
+		TEST_FORMULA_1, TEST_FORMULA_2, TEST_FORMULA_3, 
+		TEST_FORMULA_4, TEST_FORMULA_5,
+		"K3(J(4))2.3(13C)1.2", "K3(J(4)2(J4(K2.2(F3J))3F2.3))2.5",
+		"C(13C)H3 ((CH3)2(13)(C)3)2 (2H)", "H2(3)O", "[Fe(CN)6]4 Na{O}0.5",
+		"()H2()3", "13", "H2(3(D4))", "3(H3.4)O", "H(3.4)O", "3.2H", 
+		"((((H)))", "H2(D4))3", "((H2)3)(2)", "(2)H",
+		"(H0.1H0.2)0.3", "C2(H0.1H0.2)0.7", "H0.1(H0.2(H0.3)0.7)0.3",
+		"((H0.1)0.7H0.3(O0.3H0.7)1.1)0.3H0.1 [C0.1(H0.2)0.3]0.9C0.2",
+		NULL
+	};
+	cfp::Parser tree, flat;
+	flat.setEmpiricalOnly(true);
+	CHECK(flat.empiricalOnly());
+	CHECK(!tree.empiricalOnly());
+	for(int order = cfp::ORDER_LEXICAL; order <= cfp::ORDER_APPEARANCE; order++)
+	{
+		tree.setElementOrder(cfp::ElementOrder(order));
+		flat.setElementOrder(cfp::ElementOrder(order));
+		for(size_t i=0; formulas[i]; i++)
+		{
+			CHECK_EQUAL(processOrError(tree, formulas[i]), 
+			            processOrError(flat, formulas[i]));
+			if (!tree.validate(formulas[i], strlen(formulas[i])).ok()) {
+				continue;
+			}
+			// bit-identical coefficients
+			CHECK_EQUAL(exactString(tree.empirical()), 
+			            exactString(flat.empirical()));
+		}
+	}
+	flat.setElementOrder(cfp::ORDER_LEXICAL);
+	flat.process("H2(SO4)3", 8);
+	CHECK_EQUAL(0, flat.toMarkup().compare("H<sub>2</sub> O<sub>12</sub> S<sub>3</sub>"));
+}
+
+TEST(ParserCompactEmpirical)
+{
+	cfp::Parser p;
+	CHECK(p.compactEmpirical().empty());
+	p.setElementOrder(cfp::ORDER_APPEARANCE);
+	p.process("OC(13C)H3(CH2)2Br", 17);
+	const cfp::CompactCompound& c = p.compactEmpirical();
+	CHECK_EQUAL((size_t)5, c.size());
+	std::stringstream ss1, ss2;
+	ss1 << c;
+	CHECK_EQUAL(0, ss1.str().compare("Br C3 (13C) H7 O")); // always lexical
+	ss2 << c.toCompound();
+	CHECK_EQUAL(0, ss2.str().compare(ss1.str()));
+
+	CHECK(c.find("C") != c.end());
+	CHECK_EQUAL(3.0, c.find("C")->coefficient());
+	CHECK_EQUAL(1.0, c.find(cfp::symbolId("C"), 13)->coefficient());
+	CHECK_EQUAL(7.0, c.find(1)->coefficient());
+	CHECK(c.find("C", 12) == c.end());
+	CHECK(c.find("N") == c.end());
+	// looking up an unknown symbol does not register it
+	const cfp::SymbolId known = cfp::symbolId("Qfind");
+	CHECK(c.find("Qfound") == c.end());
+	CHECK_EQUAL(known + 1, cfp::symbolId("Qnext"));
+
+	// exceeding the inline storage
+	const char * large = "H He Li Be B C N O F Ne Na Mg Al Si P S Cl Ar K Ca (2H)3";
+	p.setElementOrder(cfp::ORDER_LEXICAL);
+	p.process(large, strlen(large));
+	cfp::CompactCompound copy(p.compactEmpirical());
+	CHECK_EQUAL((size_t)21, copy.size());
+	std::stringstream ss3, ss4;
+	ss3 << copy;
+	ss4 << p.empirical();
+	CHECK_EQUAL(ss4.str(), ss3.str());
+	CHECK_EQUAL(3.0, copy.find("H", 2)->coefficient());
+	cfp::CompactCompound assigned;
+	assigned = copy;
+	CHECK_EQUAL((size_t)21, assigned.size());
+	p.process("H2O", 3);
+	CHECK_EQUAL((size_t)2, p.compactEmpirical().size());
+	CHECK_EQUAL((size_t)21, assigned.size());
+	CHECK(assigned.find("Ca") != assigned.end());
+}
+
+TEST(ParserBatch)
+{
+	const char * strs[] = {
+		"H2O", "", "C6H12O6", "H2)", "(13C)2H 1H", "Xy", "NaCl", NULL
+	};
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; strs[i]; i++) {
+		cfp::FormulaView f = { strs[i], strlen(strs[i]) };
+		formulas.push_back(f);
+	}
+	cfp::Parser p, single;
+	p.setStrictSymbols(true);
+	single.setStrictSymbols(true);
+	cfp::BatchResult r;
+	for(int run=0; run < 2; run++) // the result is reused
+	{
+		p.parseBatch(&formulas[0], formulas.size(), r);
+		CHECK_EQUAL(formulas.size(), r.size());
+		CHECK_EQUAL(formulas.size()+1, r.offsets.size());
+		CHECK_EQUAL(r.symbols.size(), r.offsets.back());
+		CHECK_EQUAL(r.symbols.size(), r.nucleons.size());
+		CHECK_EQUAL(r.symbols.size(), r.coefficients.size());
+		for(size_t i=0; i < formulas.size(); i++)
+		{
+			if (r.status[i] != cfp::ERROR_NONE) {
+				CHECK_EQUAL(r.offsets[i], r.offsets[i+1]);
+				continue;
+			}
+			cfp::Compound c;
+			for(size_t k = r.offsets[i]; k < r.offsets[i+1]; k++) {
+				c.push_back(cfp::CompoundElement(cfp::CompactElement(
+					r.symbols[k], r.nucleons[k], r.coefficients[k])));
+			}
+			std::stringstream ss;
+			ss << c;
+			CHECK_EQUAL(processOrError(single, strs[i]), ss.str());
+		}
+	}
+	CHECK_EQUAL(cfp::ERROR_NONE, r.status[0]);
+	CHECK_EQUAL(cfp::ERROR_NONE, r.status[1]);
+	CHECK_EQUAL(cfp::ERROR_LONE_CLOSING_BRACKET, r.status[3]);
+	CHECK_EQUAL((size_t)2, r.errorStart[3]);
+	CHECK_EQUAL((size_t)1, r.errorLength[3]);
+	CHECK_EQUAL(cfp::ERROR_UNKNOWN_SYMBOL, r.status[5]);
+	CHECK_EQUAL((size_t)2, r.errorLength[5]);
+	CHECK_EQUAL((size_t)2, r.offsets[6]-r.offsets[4]); // 13C, H
+	CHECK(p.empirical().empty());
+}
+
+TEST(ParserBatchParallel)
+{
+	// skewed lengths, errors and symbols outside the periodic table
+	std::vector<std::string> strs;
+	for(size_t i=0; i < 5000; i++) 
+	{
+		std::stringstream ss;
+		if (i % 997 == 0) {
+			for(size_t k=0; k < 2000; k++) ss << "(CH3)" << k % 7;
+		} else if (i % 13 == 0) {
+			ss << "H2(O";
+		} else {
+			ss << "Xq" << i % 50 << " C" << i % 11 << "(13C)H" << i;
+		}
+		strs.push_back(ss.str());
+	}
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; i < strs.size(); i++) {
+		cfp::FormulaView f = { strs[i].c_str(), strs[i].length() };
+		formulas.push_back(f);
+	}
+	cfp::Parser p;
+	p.setElementOrder(cfp::ORDER_HILL);
+	cfp::BatchResult expected;
+	p.parseBatch(&formulas[0], formulas.size(), expected);
+	for(size_t threads=0; threads <= 8; threads += 4)
+	{
+		cfp::BatchResult r;
+		p.parseBatchParallel(&formulas[0], formulas.size(), r, threads);
+		CHECK_EQUAL(expected.size(), r.size());
+		CHECK(expected.offsets == r.offsets);
+		CHECK(expected.status == r.status);
+		CHECK(expected.errorStart == r.errorStart);
+		CHECK(expected.errorLength == r.errorLength);
+		CHECK(expected.symbols == r.symbols);
+		CHECK(expected.nucleons == r.nucleons);
+		CHECK(expected.coefficients == r.coefficients);
+	}
+	cfp::BatchResult empty;
+	p.parseBatchParallel(NULL, 0, empty);
+	CHECK_EQUAL((size_t)0, empty.size());
+	CHECK_EQUAL((size_t)1, empty.offsets.size());
+}
+
+/// Returns exactString() of the formula \e i of a batch.
+static std::string
+batchString(const cfp::BatchResult& r, size_t i)
+{
+	cfp::Compound c;
+	for(size_t k = r.offsets[i]; k < r.offsets[i+1]; k++) {
+		c.push_back(cfp::CompoundElement(cfp::CompactElement(
+			r.symbols[k], r.nucleons[k], r.coefficients[k])));
+	}
+	return exactString(c);
+}
+
+TEST(ParserBatchExact)
+{
+	// fractional coefficients in groups, the batches run in 
+	// empirical-only mode
+	const char * strs[] = {
+		"(H0.1H0.2)0.3", "C2(H0.1H0.2)0.7", "H0.1(H0.2(H0.3)0.7)0.3",
+		"((H0.1)0.7H0.3(O0.3H0.7)1.1)0.3H0.1 [C0.1(H0.2)0.3]0.9C0.2",
+		"[Fe(CN0.3)6.1]0.4 K0.7(13C0.1)0.9", NULL
+	};
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; strs[i]; i++) {
+		cfp::FormulaView f = { strs[i], strlen(strs[i]) };
+		formulas.push_back(f);
+	}
+	cfp::Parser p, single;
+	cfp::BatchResult r, parallel;
+	p.parseBatch(&formulas[0], formulas.size(), r);
+	p.parseBatchParallel(&formulas[0], formulas.size(), parallel, 2);
+	CHECK_EQUAL(formulas.size(), r.size());
+	CHECK_EQUAL(formulas.size(), parallel.size());
+	for(size_t i=0; i < formulas.size(); i++)
+	{
+		const std::string expected = 
+			exactString(single.process(strs[i], strlen(strs[i])));
+		CHECK_EQUAL(expected, batchString(r, i));
+		CHECK_EQUAL(expected, batchString(parallel, i));
+	}
+
+	// files are parsed the same way
+	const char * path = "test_auto_parser_exact.txt";
+	{
+		std::ofstream f(path, std::ios::out | std::ios::binary);
+		for(size_t i=0; strs[i]; i++) f << strs[i] << "\n";
+	}
+	cfp::BatchResult file;
+	p.parseFile(path, file, 0, 2);
+	CHECK_EQUAL(formulas.size(), file.size());
+	for(size_t i=0; i < file.size() && i < formulas.size(); i++) {
+		CHECK_EQUAL(batchString(r, i), batchString(file, i));
+	}
+	std::remove(path);
+}
+
+TEST(ParserCache)
+{
+	const char * strs[] = {
+		"H2O", "C6H12O6", "H2)", "Xy2 (13C)H", "K3(J(4)2(J4(K2.2(F3J))3F2.3))2.5", 
+		NULL
+	};
+	cfp::FormulaCache cache(64);
+	cfp::Parser p, plain;
+	p.setEmpiricalOnly(true);
+	p.setCache(&cache);
+	CHECK(p.cache() == &cache);
+	CHECK(cfp::Parser(p).cache() == &cache);
+	for(int run=0; run < 3; run++) {
+		for(size_t i=0; strs[i]; i++) {
+			CHECK_EQUAL(processOrError(plain, strs[i]), processOrError(p, strs[i]));
+		}
+	}
+	cfp::FormulaCache::Statistics stats = cache.statistics();
+	CHECK_EQUAL((size_t)4, stats.size); // errors are not cached
+	CHECK_EQUAL((size_t)8, stats.hits);
+	CHECK_EQUAL((size_t)7, stats.misses);
+	CHECK_EQUAL((size_t)0, stats.evictions);
+
+	// hits are bit-identical to the tree mode
+	const char * fractional = "((H0.1)0.7H0.3(O0.3H0.7)1.1)0.3H0.1";
+	const std::string exact = 
+		exactString(plain.process(fractional, strlen(fractional)));
+	for(int run=0; run < 2; run++) {
+		p.process(fractional, strlen(fractional));
+		CHECK_EQUAL(exact, exactString(p.empirical()));
+	}
+	CHECK_EQUAL(stats.hits + 1, cache.statistics().hits);
+
+	// the settings are part of the key
+	p.setStrictSymbols(true);
+	CHECK_EQUAL(std::string("Unknown element symbol ! 0 2"), 
+	            processOrError(p, "Xy2 (13C)H"));
+	p.setStrictSymbols(false);
+	p.setElementOrder(cfp::ORDER_APPEARANCE);
+	CHECK_EQUAL(std::string("Xy2 (13C) H"), processOrError(p, "Xy2 (13C)H"));
+	CHECK_EQUAL(std::string("Xy2 (13C) H"), processOrError(p, "Xy2 (13C)H"));
+	p.setElementOrder(cfp::ORDER_LEXICAL);
+	CHECK_EQUAL(std::string("(13C) H Xy2"), processOrError(p, "Xy2 (13C)H"));
+
+	// not used in tree mode, the markup needs the structure
+	p.setEmpiricalOnly(false);
+	stats = cache.statistics();
+	p.process("H2O", 3);
+	CHECK_EQUAL("H<sub>2</sub>O", p.toMarkup());
+	CHECK_EQUAL(stats.hits + stats.misses, 
+	            cache.statistics().hits + cache.statistics().misses);
+
+	cache.clear();
+	CHECK_EQUAL((size_t)0, cache.statistics().size);
+	CHECK_EQUAL((size_t)0, cache.statistics().hits);
+
+	// bounded, recently used entries survive
+	cfp::FormulaCache small(4);
+	CHECK_EQUAL((size_t)4, small.capacity());
+	p.setEmpiricalOnly(true);
+	p.setCache(&small);
+	for(size_t i=0; i < 100; i++) {
+		std::stringstream ss;
+		ss << "C" << i + 1 << "H" << 2*i;
+		processOrError(p, ss.str().c_str());
+		CHECK_EQUAL(processOrError(plain, ss.str().c_str()), 
+		            processOrError(p, ss.str().c_str()));
+	}
+	stats = small.statistics();
+	CHECK(stats.size <= 4);
+	CHECK_EQUAL((size_t)100, stats.hits);
+	CHECK(stats.evictions >= 96);
+
+	// batches use the cache too
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; i < 1000; i++) {
+		cfp::FormulaView f = { strs[i % 5], strlen(strs[i % 5]) };
+		formulas.push_back(f);
+	}
+	cfp::BatchResult expected, r;
+	plain.parseBatch(&formulas[0], formulas.size(), expected);
+	p.setCache(&cache);
+	p.parseBatchParallel(&formulas[0], formulas.size(), r, 2);
+	CHECK(expected.offsets == r.offsets);
+	CHECK(expected.status == r.status);
+	CHECK(expected.symbols == r.symbols);
+	CHECK(expected.coefficients == r.coefficients);
+	CHECK(cache.statistics().hits >= 800 - 8);
+}
+
+TEST(ParserAssignmentMoveSwap)
+{
+	cfp::Parser p, q;
+	p.setMaxNestingLevel(7);
+	p.setElementOrder(cfp::ORDER_HILL);
+	p.process("H2O C2", 6);
+	q = p; // deep copy
+	CHECK_EQUAL((size_t)7, q.maxNestingLevel());
+	CHECK_EQUAL(std::string("H2O C2"), q.formula());
+	CHECK_EQUAL(std::string("C2 H2 O"), processOrError(q, "H2O C2"));
+	p.process("NaCl", 4);
+	CHECK_EQUAL(std::string("H2O C2"), q.formula());
+	q = q;
+	CHECK_EQUAL((size_t)3, q.empirical().size());
+
+	cfp::Parser m(std::move(q));
+	CHECK_EQUAL((size_t)3, m.empirical().size());
+	q = p; // moved-from Parsers may be assigned to
+	CHECK_EQUAL(std::string("NaCl"), q.formula());
+	cfp::Parser n;
+	n = std::move(m);
+	CHECK_EQUAL(cfp::ORDER_HILL, n.elementOrder());
+	cfp::swap(n, q);
+	CHECK_EQUAL(std::string("NaCl"), n.formula());
+	CHECK_EQUAL(std::string("C2 H2 O"), processOrError(q, "H2O C2"));
+	CHECK_EQUAL(std::string("Cl Na"), processOrError(n, "NaCl"));
+}
+
+/// Checks the order and the columns passed to a BatchSink.
+struct CheckingSink: public cfp::BatchSink
+{
+	size_t lines;             //!< Number of lines received.
+	std::vector<std::string> ids; //!< All IDs received.
+	cfp::BatchResult result;  //!< All results received.
+
+	CheckingSink() : lines(0) {}
+
+	void 
+	consume(size_t firstLine, const cfp::FormulaView * idCol, 
+	        const cfp::FormulaView *, const cfp::BatchResult& r)
+	{
+		CHECK_EQUAL(lines, firstLine);
+		lines += r.size();
+		for(size_t i=0; idCol && i < r.size(); i++) {
+			ids.push_back(std::string(idCol[i].str, idCol[i].len));
+		}
+		result.append(r);
+	}
+};
+
+TEST(ParserParseFile)
+{
+	const char * path = "test_auto_parser_file.txt";
+	{
+		std::ofstream f(path, std::ios::out | std::ios::binary);
+		f << "a1\tH2O\r\n" << "b2\tH2)\n" << "\n" << "C6H12O6\n" 
+		  << "c3\t(13C)2H 1H";
+	}
+	const char * strs[] = { "H2O", "H2)", "", "C6H12O6", "(13C)2H 1H" };
+	std::vector<cfp::FormulaView> formulas;
+	for(size_t i=0; i < 5; i++) {
+		cfp::FormulaView f = { strs[i], strlen(strs[i]) };
+		formulas.push_back(f);
+	}
+	cfp::Parser p;
+	cfp::BatchResult expected, r;
+	cfp::Parser(p).parseBatch(&formulas[0], formulas.size(), expected);
+
+	CheckingSink sink;
+	p.parseFile(path, sink, '\t');
+	CHECK_EQUAL((size_t)5, sink.lines);
+	CHECK(expected.status == sink.result.status);
+	CHECK(expected.offsets == sink.result.offsets);
+	CHECK(expected.symbols == sink.result.symbols);
+	CHECK_EQUAL((size_t)2, sink.result.errorStart[1]); // within the formula
+	CHECK_EQUAL(5u, sink.ids.size());
+	CHECK_EQUAL("a1", sink.ids[0]);
+	CHECK_EQUAL("", sink.ids[2]);
+	CHECK_EQUAL("", sink.ids[3]);
+	CHECK_EQUAL("c3", sink.ids[4]);
+
+	// without ID column, the IDs are part of the formulas
+	p.parseFile(path, r);
+	CHECK_EQUAL((size_t)5, r.size());
+	CHECK_EQUAL(cfp::ERROR_SYM_BEG_LOW_CHAR, r.status[0]);
+	CHECK_EQUAL(cfp::ERROR_NONE, r.status[3]);
+
+	// many chunks, several threads
+	{
+		std::ofstream f(path, std::ios::out | std::ios::binary);
+		for(size_t i=0; i < 60000; i++) {
+			f << i << "," << "Xq" << i % 50 << " C" << i % 11 << "(13C)H" << i;
+			if (i % 13 == 0) f << "(";
+			f << "\n";
+		}
+	}
+	CheckingSink big;
+	p.parseFile(path, big, ',', 4);
+	CHECK_EQUAL((size_t)60000, big.lines);
+	CHECK_EQUAL("59999", big.ids.back());
+	cfp::BatchResult single;
+	p.parseFile(path, single, ',', 1);
+	CHECK(single.offsets == big.result.offsets);
+	CHECK(single.status == big.result.status);
+	CHECK(single.symbols == big.result.symbols);
+	CHECK(single.coefficients == big.result.coefficients);
+	CHECK_EQUAL(cfp::ERROR_MISSING_CLOSING_BRACKET, single.status[13]);
+
+	{ std::ofstream f(path, std::ios::out | std::ios::binary); }
+	p.parseFile(path, r);
+	CHECK_EQUAL((size_t)0, r.size());
+	CHECK_EQUAL((size_t)1, r.offsets.size());
+	std::remove(path);
+}
+
+TEST(ParserProcessingDeepNesting)
+{
+	const size_t depth = 100000;
+	cfp::Parser p;
+	p.setMaxNestingLevel(depth+1);
+	std::string str;
+	for(size_t i=0; i < depth; i++) str.append("(H");
+	for(size_t i=0; i < depth; i++) str.append(")");
+	p.process(str.c_str(), str.length());
+	CHECK_EQUAL((size_t)1, p.empirical().size());
+	std::stringstream ss;
+	ss << p.empirical();
+	CHECK_EQUAL(0, ss.str().compare("H100000"));
+}
+
+/// A formula which ends with a character of a class in a lexer state,
+/// and the expected outcome.
+struct LexerCase
+{
+	const char *   formula;  //!< The formula.
+	size_t         len;      //!< Number of characters of formula.
+	cfp::ErrorCode code;     //!< Expected error.
+	size_t         start;    //!< Expected position of the error.
+	const char *   result;   //!< Expected empirical formula, if valid.
+};
+
+#define LEXER_CASE(f, code, start, result) { f, sizeof(f)-1, code, start, result }
+
+TEST(ParserLexerTransitions)
+{
+	// the lexer state is the type of the token before the last 
+	// character (or bracket), see transitionTable in parserdetails.cpp
+	const LexerCase cases[] = {
+		// symbol
+		LEXER_CASE("Ca$",     cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("Ca\xC3\xA9", cfp::ERROR_INVALID_CHAR,  2, ""),
+		LEXER_CASE("Ca\x80",  cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("Ca\xFF",  cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("Ca\0",    cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("Ca3",     cfp::ERROR_NONE,             0, "Ca3"),
+		LEXER_CASE("Ca.",     cfp::ERROR_DECIM_BETW_INT,   2, ""),
+		LEXER_CASE("Ca,",     cfp::ERROR_DECIM_BETW_INT,   2, ""),
+		LEXER_CASE("CaO",     cfp::ERROR_NONE,             0, "Ca O"),
+		LEXER_CASE("Cae",     cfp::ERROR_NONE,             0, "Cae"),
+		LEXER_CASE("Ca(N)",   cfp::ERROR_NONE,             0, "Ca N"),
+		LEXER_CASE("(Ca)",    cfp::ERROR_NONE,             0, "Ca"),
+		LEXER_CASE("Ca ",     cfp::ERROR_NONE,             0, "Ca"),
+		// group
+		LEXER_CASE("(H)$",    cfp::ERROR_INVALID_CHAR,     3, ""),
+		LEXER_CASE("(H)\xC3\xA9", cfp::ERROR_INVALID_CHAR, 3, ""),
+		LEXER_CASE("(H)3",    cfp::ERROR_NONE,             0, "H3"),
+		LEXER_CASE("(H).",    cfp::ERROR_DECIM_BETW_INT,   3, ""),
+		LEXER_CASE("(H),",    cfp::ERROR_DECIM_BETW_INT,   3, ""),
+		LEXER_CASE("(H)O",    cfp::ERROR_NONE,             0, "H O"),
+		LEXER_CASE("(H)e",    cfp::ERROR_SYM_BEG_LOW_CHAR, 3, ""),
+		LEXER_CASE("(H)(N)",  cfp::ERROR_NONE,             0, "H N"),
+		LEXER_CASE("((H))",   cfp::ERROR_NONE,             0, "H"),
+		LEXER_CASE("(H) ",    cfp::ERROR_NONE,             0, "H"),
+		// integer
+		LEXER_CASE("H2$",     cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("H2\xC3\xA9", cfp::ERROR_INVALID_CHAR,  2, ""),
+		LEXER_CASE("H23",     cfp::ERROR_NONE,             0, "H23"),
+		LEXER_CASE("H2.",     cfp::ERROR_NONE,             0, "H2"),
+		LEXER_CASE("H2,",     cfp::ERROR_NONE,             0, "H2"),
+		LEXER_CASE("H2O",     cfp::ERROR_NONE,             0, "H2 O"),
+		LEXER_CASE("H2e",     cfp::ERROR_SYM_BEG_LOW_CHAR, 2, ""),
+		LEXER_CASE("H2(N)",   cfp::ERROR_NONE,             0, "H2 N"),
+		LEXER_CASE("(H2)",    cfp::ERROR_NONE,             0, "H2"),
+		LEXER_CASE("H2 ",     cfp::ERROR_NONE,             0, "H2"),
+		// real number
+		LEXER_CASE("H2.5$",   cfp::ERROR_INVALID_CHAR,     4, ""),
+		LEXER_CASE("H2.5\xC3\xA9", cfp::ERROR_INVALID_CHAR, 4, ""),
+		LEXER_CASE("H2.53",   cfp::ERROR_NONE,             0, "H2.53"),
+		LEXER_CASE("H2.5.",   cfp::ERROR_DECIM_BETW_INT,   4, ""),
+		LEXER_CASE("H2.5,",   cfp::ERROR_DECIM_BETW_INT,   4, ""),
+		LEXER_CASE("H2.5O",   cfp::ERROR_NONE,             0, "H2.5 O"),
+		LEXER_CASE("H2.5e",   cfp::ERROR_SYM_BEG_LOW_CHAR, 4, ""),
+		LEXER_CASE("H2.5(N)", cfp::ERROR_NONE,             0, "H2.5 N"),
+		LEXER_CASE("(H2.5)",  cfp::ERROR_NONE,             0, "H2.5"),
+		LEXER_CASE("H2.5 ",   cfp::ERROR_NONE,             0, "H2.5"),
+		// none, after a space
+		LEXER_CASE("H $",     cfp::ERROR_INVALID_CHAR,     2, ""),
+		LEXER_CASE("H \xC3\xA9", cfp::ERROR_INVALID_CHAR,  2, ""),
+		LEXER_CASE("H 3",     cfp::ERROR_NONE,             0, "H3"),
+		LEXER_CASE("H .",     cfp::ERROR_DECIM_BETW_INT,   2, ""),
+		LEXER_CASE("H ,",     cfp::ERROR_DECIM_BETW_INT,   2, ""),
+		LEXER_CASE("H O",     cfp::ERROR_NONE,             0, "H O"),
+		LEXER_CASE("H e",     cfp::ERROR_SYM_BEG_LOW_CHAR, 2, ""),
+		LEXER_CASE("H (N)",   cfp::ERROR_NONE,             0, "H N"),
+		LEXER_CASE("(H )",    cfp::ERROR_NONE,             0, "H"),
+		LEXER_CASE("H  ",     cfp::ERROR_NONE,             0, "H"),
+		// none, at the beginning
+		LEXER_CASE("$",       cfp::ERROR_INVALID_CHAR,     0, ""),
+		LEXER_CASE("\xC3\xA9", cfp::ERROR_INVALID_CHAR,    0, ""),
+		LEXER_CASE("\x80",    cfp::ERROR_INVALID_CHAR,     0, ""),
+		LEXER_CASE("\xFF",    cfp::ERROR_INVALID_CHAR,     0, ""),
+		LEXER_CASE("\0",      cfp::ERROR_INVALID_CHAR,     0, ""),
+		LEXER_CASE("3",       cfp::ERROR_NONE,             0, "(3)"),
+		LEXER_CASE(".",       cfp::ERROR_DECIM_BETW_INT,   0, ""),
+		LEXER_CASE(",",       cfp::ERROR_DECIM_BETW_INT,   0, ""),
+		LEXER_CASE("O",       cfp::ERROR_NONE,             0, "O"),
+		LEXER_CASE("e",       cfp::ERROR_SYM_BEG_LOW_CHAR, 0, ""),
+		LEXER_CASE("(N)",     cfp::ERROR_NONE,             0, "N"),
+		LEXER_CASE("()",      cfp::ERROR_NONE,             0, ""),
+		LEXER_CASE(" ",       cfp::ERROR_NONE,             0, ""),
+	};
+	cfp::Parser p;
+	for(size_t i=0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		const LexerCase& c = cases[i];
+		cfp::Status s = p.tryProcess(c.formula, c.len);
+		CHECK_EQUAL(c.code, s.code);
+		if (!s.ok()) {
+			CHECK_EQUAL(c.start, s.start);
+			CHECK_EQUAL((size_t)1, s.length);
+		} else {
+			std::stringstream ss;
+			ss << p.empirical();
+			CHECK_EQUAL(c.result, ss.str());
+		}
+		CHECK_EQUAL(c.code, p.validate(c.formula, c.len).code);
+	}
+}
+
+#undef LEXER_CASE
+
+TEST(ParserStructuralIndex)
+{
+	// each window of 256 characters contains all byte values
+	std::string str;
+	for(size_t i=0; i < 600; i++) str.push_back(char(i * 167 + 13));
+	// lengths around the vector sizes 16 and 32 and the block size 64,
+	// tails shorter than one vector at various alignments
+	for(size_t len=0; len <= str.length(); len += (len < 200) ? 1 : 37)
+	{
+		cfp::StructuralIndex ref;
+		ref.build(str.data(), len, cfp::StructuralIndex::IMPL_SCALAR);
+		for(int impl = cfp::StructuralIndex::IMPL_SCALAR; 
+		    impl <= cfp::StructuralIndex::IMPL_AVX2; impl++)
+		{
+			cfp::StructuralIndex::Impl im = cfp::StructuralIndex::Impl(impl);
+			if (!cfp::StructuralIndex::supported(im)) continue;
+			cfp::StructuralIndex index;
+			index.build(str.data(), len, im);
+			CHECK_EQUAL(len, index.length());
+			CHECK_EQUAL((len + 63) / 64, index.blocks());
+			size_t mismatches = 0;
+			for(size_t b=0; b < index.blocks(); b++) {
+				for(int c=0; c < cfp::CHAR_CLASS_COUNT; c++) 
+				{
+					uint64_t expected = 0;
+					for(size_t i=0; i < 64 && b*64 + i < len; i++) {
+						if (cfp::charClass(str[b*64 + i]) == c) {
+							expected |= uint64_t(1) << i;
+						}
+					}
+					if (index.block(b).cls[c] != expected) mismatches++;
+					if (index.block(b).cls[c] != ref.block(b).cls[c]) {
+						mismatches++;
+					}
+				}
+			}
+			CHECK_EQUAL((size_t)0, mismatches);
+			CHECK_EQUAL(ref.firstInvalid(), index.firstInvalid());
+		}
+	}
+}
+
+TEST(ParserEmpiricalDeepNesting)
+{
+	// each group item is stored and read once in empirical-only mode,
+	// so the time grows linearly with the depth as in tree mode
+	typedef std::chrono::steady_clock clock;
+	const size_t depth = 20000;
+	cfp::Parser tree, empirical;
+	tree.setMaxNestingLevel(depth+1);
+	empirical.setMaxNestingLevel(depth+1);
+	empirical.setEmpiricalOnly(true);
+	std::string str;
+	for(size_t i=0; i < depth; i++) str.append("(H");
+	for(size_t i=0; i < depth; i++) str.append(i % 2 ? ")1.1" : ")0.9");
+	clock::time_point t0 = clock::now();
+	const std::string expected = 
+		exactString(tree.process(str.c_str(), str.length()));
+	clock::time_point t1 = clock::now();
+	const std::string result = 
+		exactString(empirical.process(str.c_str(), str.length()));
+	clock::time_point t2 = clock::now();
+	CHECK_EQUAL(expected, result);
+	CHECK(t2 - t1 < 10 * (t1 - t0) + std::chrono::milliseconds(100));
+}
+
+TEST(ParserValidate)
+{
+	const char * formulas[] = {
+		"H2O", "Ca(OH)2 [Fe(CN)6]4", "13C2 H(2)3", "", "H$O", "a2O", 
+		"H.2O", "3.2H", "H2(3(D4))", "3(H3.4)O", "H2)", "SdFeH(", 
+		"N((((H2O))))", "H2(SO4)3 Xy", NULL
+	};
+	cfp::Parser p;
+	p.setMaxNestingLevel(4);
+	p.setFormula("CO2");
+	p.process();
+	std::vector<cfp::FormulaView> views;
+	for(int strict=0; strict < 2; strict++)
+	{
+		p.setStrictSymbols(strict == 1);
+		views.clear();
+		std::vector<cfp::Status> expected;
+		for(size_t i=0; formulas[i]; i++)
+		{
+			const size_t len = strlen(formulas[i]);
+			cfp::FormulaView v = { formulas[i], len };
+			views.push_back(v);
+			cfp::Parser ref(p);
+			expected.push_back(ref.tryProcess(formulas[i], len));
+			cfp::Status s = p.validate(formulas[i], len);
+			CHECK_EQUAL(expected.back().code, s.code);
+			CHECK_EQUAL(expected.back().start, s.start);
+			CHECK_EQUAL(expected.back().length, s.length);
+		}
+		std::vector<cfp::Status> batch;
+		p.validateBatch(&views[0], views.size(), batch);
+		CHECK_EQUAL(views.size(), batch.size());
+		for(size_t i=0; i < batch.size() && i < expected.size(); i++) {
+			CHECK_EQUAL(expected[i].code, batch[i].code);
+			CHECK_EQUAL(expected[i].start, batch[i].start);
+		}
+	}
+	// the formula and the result of the parser are kept
+	CHECK_EQUAL(0, p.formula().compare("CO2"));
+	CHECK_EQUAL((size_t)2, p.empirical().size());
+}
+
+TEST(ParserStatistics)
+{
+	typedef cfp::Parser::Statistics Stats;
+	if (!Stats::available()) return;
+	cfp::Parser p;
+	const Stats& s = p.statistics();
+	CHECK_EQUAL((size_t)0, s.formulas);
+
+	p.process("H2(13C)O2.5[Fe(CN)6]4H", 22);
+	CHECK_EQUAL((size_t)1, s.formulas);
+	CHECK_EQUAL((size_t)22, s.characters);
+	CHECK_EQUAL((size_t)7, s.tokens[Stats::TOKEN_SYMBOL]);
+	CHECK_EQUAL((size_t)4, s.tokens[Stats::TOKEN_INT]);
+	CHECK_EQUAL((size_t)1, s.tokens[Stats::TOKEN_FLOAT]);
+	CHECK_EQUAL((size_t)3, s.tokens[Stats::TOKEN_GROUP]);
+	CHECK_EQUAL((size_t)3, s.groups);
+	CHECK_EQUAL((size_t)2, s.maxDepth);
+	CHECK_EQUAL((size_t)10, s.treeNodes);
+	CHECK_EQUAL((size_t)1, s.mergedElements);
+	CHECK(s.allocatedBytes > 0);
+	for(size_t i=0; i < Stats::STAGE_COUNT; i++) {
+		CHECK_EQUAL((uint64_t)0, s.nanoseconds[i]);
+	}
+
+	// errors by kind, including validation and all diagnostics
+	CHECK(!p.tryProcess("H$O", 3).ok());
+	CHECK(!p.validate("H2)", 3).ok());
+	std::vector<cfp::Status> diagnostics;
+	CHECK_EQUAL((size_t)4, p.diagnoseView("a$b)", 4, diagnostics));
+	CHECK_EQUAL((size_t)4, s.formulas);
+	CHECK_EQUAL((size_t)32, s.characters);
+	size_t errors = 0;
+	for(size_t i=0; i < cfp::ERROR_CODE_COUNT; i++) errors += s.errors[i];
+	CHECK_EQUAL((size_t)6, errors);
+	CHECK_EQUAL((size_t)2, s.errors[cfp::ERROR_INVALID_CHAR]);
+	CHECK_EQUAL((size_t)2, s.errors[cfp::ERROR_LONE_CLOSING_BRACKET]);
+
+	// no tree in empirical-only mode
+	cfp::Parser e;
+	e.setEmpiricalOnly(true);
+	e.setStageTiming(true);
+	std::string polymer("HO");
+	for(int i=0; i < 2000; i++) polymer += "(C2H4O)";
+	polymer += "H";
+	e.process(polymer.c_str(), polymer.length());
+	CHECK_EQUAL((size_t)0, e.statistics().treeNodes);
+	CHECK_EQUAL((size_t)2000, e.statistics().groups);
+	CHECK(e.statistics().mergedElements > 0);
+	CHECK(e.statistics().nanoseconds[Stats::STAGE_PARSE] > 0);
+
+	// summed up, e.g. over threads
+	Stats sum;
+	sum += s;
+	sum += e.statistics();
+	CHECK_EQUAL((size_t)5, sum.formulas);
+	CHECK_EQUAL((size_t)2, sum.maxDepth);
+	CHECK_EQUAL(s.groups + 2000, sum.groups);
+
+	// copies start at zero, reset clears
+	cfp::Parser c(p);
+	CHECK_EQUAL((size_t)0, c.statistics().formulas);
+	p.resetStatistics();
+	CHECK_EQUAL((size_t)0, s.formulas);
+	CHECK_EQUAL((size_t)0, s.errors[cfp::ERROR_INVALID_CHAR]);
+
+	// the batch functions add the counters of their threads
+	std::vector<std::string> strs(1000, "C6H12O6");
+	std::vector<cfp::FormulaView> views;
+	for(size_t i=0; i < strs.size(); i++) {
+		cfp::FormulaView v = { strs[i].c_str(), strs[i].length() };
+		views.push_back(v);
+	}
+	cfp::BatchResult result;
+	p.parseBatchParallel(&views[0], views.size(), result, 4);
+	CHECK_EQUAL((size_t)1000, s.formulas);
+	CHECK_EQUAL((size_t)7000, s.characters);
+	CHECK_EQUAL((size_t)3000, s.tokens[Stats::TOKEN_SYMBOL]);
+}
+
+/// Checks the result of Parser::tryEdit against parsing the new formula.
+static void 
+checkEdit(cfp::Parser& p, size_t offset, size_t removed, const char * text)
+{
+	std::string expected(p.formula());
+	offset = std::min(offset, expected.length());
+	expected.replace(offset, removed, text ? text : "");
+	const cfp::Status s = p.tryEdit(offset, removed, text, 
+	                                text ? strlen(text) : 0);
+	CHECK_EQUAL(expected, p.formula());
+	cfp::Parser ref;
+	ref.setStrictSymbols(p.strictSymbols());
+	const cfp::Status r = ref.tryProcess(expected.c_str(), expected.length());
+	CHECK_EQUAL(r.code, s.code);
+	CHECK_EQUAL(r.start, s.start);
+	CHECK_EQUAL(r.length, s.length);
+	if (!s.ok() || !r.ok()) return;
+	CHECK_EQUAL(ref.toMarkup(), p.toMarkup());
+	CHECK_EQUAL(cfp::toMarkup(ref.empirical()), cfp::toMarkup(p.empirical()));
+}
+
+TEST(ParserEdit)
+{
+	cfp::Parser p;
+	p.setFormula("C6H12O6 NaCl");
+	CHECK_EQUAL((size_t)5, p.edit(0, 0, NULL, 0).size());
+	checkEdit(p, 7, 0, "Fe"); // C6H12O6Fe NaCl
+	checkEdit(p, 1, 1, "2");  // one token changed
+	checkEdit(p, 0, 0, "13"); // isotope of the first element
+	checkEdit(p, 4, 0, "(");  // unbalanced, then fixed
+	checkEdit(p, 8, 0, ")");
+	checkEdit(p, 5, 1, "$");  // invalid character, then removed
+	checkEdit(p, 5, 1, NULL);
+	checkEdit(p, 0, 100, "H2O"); // all replaced
+	checkEdit(p, 3, 0, "2");  // appended
+	checkEdit(p, 1, 1, NULL); // merges H and O
+	checkEdit(p, 0, 9, "");   // empty formula
+	CHECK(p.empirical().empty());
+	checkEdit(p, 0, 0, "(H2O)(2)3");
+
+	// the result of the unchanged part is reused
+	std::string polymer("HO");
+	for(int i=0; i < 1000; i++) polymer += "C2H4O ";
+	polymer += "H";
+	p.setFormula(polymer);
+	p.edit(0, 0, NULL, 0);
+	const size_t before = p.statistics().characters;
+	checkEdit(p, 3000, 1, "N");
+	checkEdit(p, 3000, 1, "O");
+	if (cfp::Parser::Statistics::available()) {
+		CHECK(p.statistics().characters - before < 20);
+	}
+	CHECK_EQUAL(polymer, p.formula());
+
+	// random edits of generated formulas
+	const char * pieces[] = {
+		"C", "H2", "13", "O", " ", "(", ")", "[CH3]", "2.5", "Cl", "l", "x"
+	};
+	cfp::FormulaGenerator::Settings settings;
+	settings.malformedFraction = 0.1;
+	cfp::FormulaGenerator gen(7, settings);
+	unsigned long random = 1;
+	for(int strict=0; strict < 2; strict++)
+	{
+		p.setStrictSymbols(strict == 1);
+		for(int i=0; i < 50; i++)
+		{
+			std::string formula;
+			gen.next(formula);
+			p.setFormula(formula);
+			for(int j=0; j < 20; j++)
+			{
+				random = random * 1103515245 + 12345;
+				const size_t len = p.formula().length();
+				const size_t offset = (random >> 8) % (len + 1);
+				const size_t removed = (random >> 16) % 3;
+				checkEdit(p, offset, removed, pieces[(random >> 20) % 12]);
+			}
+		}
+	}
+	// the formula has no result to reuse in empirical-only mode
+	p.setEmpiricalOnly(true);
+	p.setFormula("CO2");
+	const cfp::Compound& c = p.edit(1, 0, "H4", 2);
+	CHECK_EQUAL("C H<sub>4</sub> O<sub>2</sub>", cfp::toMarkup(c));
+	CHECK_THROW(p.edit(0, 0, "$", 1), cfp::Error);
+}
@@ -0,0 +1,156 @@
+/*
+ * tools/cfp_generate.cpp
+ *
+ * Copyright (c) 2009 Technische Universität Berlin, 
+ * Stranski-Laboratory for Physical und Theoretical Chemistry
+ *
+ * This file is part of libcfp.
+ *
+ * libcfp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcfp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libcfp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Author(s) of this file:
+ * Ingo Bressler (libcfp at ingobressler.net)
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <cfp/generator.h>
+
+using namespace cfp;
+
+namespace {
+
+/// Writes the command line options to \e out.
+void 
+usage(std::ostream& out)
+{
+	out << "usage: cfp_generate [options]\n"
+	    << "Writes synthetic formulas to stdout, one per line.\n"
+	    << "  --seed N           start of the sequence (0)\n"
+	    << "  --count N          number of formulas (1000)\n"
+	    << "  --min-length N     minimum characters per formula\n"
+	    << "  --max-length N     approximate maximum characters\n"
+	    << "  --depth N          maximum nesting depth of brackets\n"
+	    << "  --groups P         chance of an item being a group\n"
+	    << "  --group-items N    maximum items per group\n"
+	    << "  --group-coef P     chance of a group coefficient\n"
+	    << "  --counts P         chance of an element count\n"
+	    << "  --isotopes P       chance of an isotope\n"
+	    << "  --notation NAME    isotopes as prefix, suffix or mixed\n"
+	    << "  --decimals P       chance of a decimal count\n"
+	    << "  --commas P         chance of ',' as decimal separator\n"
+	    << "  --spaces P         chance of a space between items\n"
+	    << "  --malformed P      fraction of formulas with an error\n"
+	    << "  --elements LIST    symbols and weights, e.g. C:40,H:60\n"
+	    << "  --ids              prefix each formula with its number and "
+	       "a tab,\n"
+	    << "                     and a '!' if it is malformed\n"
+	    << "Probabilities P are in the range [0, 1]. Parse the output "
+	       "with a maximum\nnesting level larger than --depth.\n";
+}
+
+/// Parses a list of symbols with optional weights, "C:40,H:60,O".
+bool 
+parseElements(const char * list, FormulaGenerator::Settings& settings)
+{
+	settings.symbols.clear();
+	settings.weights.clear();
+	std::string item;
+	for (const char * c = list; ; c++) {
+		if (*c != ',' && *c != '\0') {
+			item += *c;
+			continue;
+		}
+		if (!item.empty()) {
+			std::string::size_type colon = item.find(':');
+			double weight = 1.0;
+			if (colon != std::string::npos) {
+				char * end = NULL;
+				weight = std::strtod(item.c_str() + colon + 1, &end);
+				if (*end != '\0' || weight < 0.0) return false;
+			}
+			settings.symbols.push_back(item.substr(0, colon));
+			settings.weights.push_back(weight);
+			item.clear();
+		}
+		if (*c == '\0') break;
+	}
+	return !settings.symbols.empty();
+}
+
+} // namespace
+
+int main (int argc, char * argv[])
+{
+	FormulaGenerator::Settings settings;
+	unsigned long long seed = 0;
+	unsigned long long count = 1000;
+	bool ids = false;
+	for(int i=1; i < argc; i++) {
+		const char * opt = argv[i];
+		if (std::strcmp(opt, "--ids") == 0) { ids = true; continue; }
+		if (std::strcmp(opt, "--help") == 0) { usage(std::cout); return 0; }
+		if (i + 1 >= argc) {
+			usage(std::cerr);
+			return 1;
+		}
+		const char * arg = argv[++i];
+		char * end = NULL;
+		const unsigned long long n = std::strtoull(arg, &end, 10);
+		const bool isNum = *end == '\0';
+		const double p = std::strtod(arg, &end);
+		const bool isProb = *end == '\0' && p >= 0.0 && p <= 1.0;
+		bool valid = true;
+		if      (std::strcmp(opt, "--seed") == 0)       { seed = n; valid = isNum; }
+		else if (std::strcmp(opt, "--count") == 0)      { count = n; valid = isNum; }
+		else if (std::strcmp(opt, "--min-length") == 0) { settings.minLength = n; valid = isNum; }
+		else if (std::strcmp(opt, "--max-length") == 0) { settings.maxLength = n; valid = isNum; }
+		else if (std::strcmp(opt, "--depth") == 0)      { settings.maxDepth = n; valid = isNum; }
+		else if (std::strcmp(opt, "--group-items") == 0) { settings.maxGroupItems = n; valid = isNum; }
+		else if (std::strcmp(opt, "--groups") == 0)     { settings.groupProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--group-coef") == 0) { settings.groupCoefficientProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--counts") == 0)     { settings.countProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--isotopes") == 0)   { settings.isotopeProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--decimals") == 0)   { settings.decimalProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--commas") == 0)     { settings.commaProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--spaces") == 0)     { settings.spaceProbability = p; valid = isProb; }
+		else if (std::strcmp(opt, "--malformed") == 0)  { settings.malformedFraction = p; valid = isProb; }
+		else if (std::strcmp(opt, "--elements") == 0)   { valid = parseElements(arg, settings); }
+		else if (std::strcmp(opt, "--notation") == 0) {
+			if      (std::strcmp(arg, "prefix") == 0) settings.isotopeNotation = FormulaGenerator::ISOTOPE_PREFIX;
+			else if (std::strcmp(arg, "suffix") == 0) settings.isotopeNotation = FormulaGenerator::ISOTOPE_SUFFIX;
+			else if (std::strcmp(arg, "mixed") == 0)  settings.isotopeNotation = FormulaGenerator::ISOTOPE_MIXED;
+			else valid = false;
+		}
+		else valid = false;
+		if (!valid) {
+			std::cerr << "invalid option: " << opt << " " << arg << std::endl;
+			usage(std::cerr);
+			return 1;
+		}
+	}
+
+	FormulaGenerator generator(seed, settings);
+	std::string formula;
+	for(unsigned long long i=0; i < count; i++) {
+		const bool malformed = generator.next(formula);
+		if (ids) std::cout << i << (malformed ? "!" : "") << '\t';
+		std::cout << formula << '\n';
+	}
+	std::cout.flush();
+	return 0;
+}